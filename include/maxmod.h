@@ -208,6 +208,13 @@ mm_callback mmGetEventHandler(void);
 ///
 /// For GBA, this function must be called every frame. If a call is missed,
 /// garbage will be heard in the output and module processing will be delayed.
+/// If the wave buffer holds more than two frames of audio (check
+/// mm_gba_system), the mixer keeps a reserve of audio and missed calls are
+/// recovered in the next call.
+///
+/// If the frames of audio are split in several chunks, this function may be
+/// called several times per frame. Each call only mixes the chunks that are
+/// missing up to the configured distance from the chunk being played.
 void mmFrame(void) __attribute((long_call));
 
 /// Returns the number of modules available in the soundbank.
@@ -584,6 +591,33 @@ void mmEffectRelease(mm_sfxhand handle);
 ///     Master volume. 0->1024 representing 0%->100% volume
 void mmSetEffectsVolume(mm_word volume);
 
+/// Set the volume of a mix bus.
+///
+/// Every voice started by a module layer is mixed into MM_BUS_MUSIC, and every
+/// voice started by mmEffect() or mmEffectEx() is mixed into MM_BUS_EFFECTS.
+/// The bus volume is applied on top of the module and effect volumes.
+///
+/// @param bus
+///     Mix bus to modify.
+/// @param volume
+///     Bus volume. 0->1024 representing 0%->100% volume
+void mmSetBusVolume(mm_bus bus, mm_word volume);
+
+/// Lower the music bus automatically while sound effects are playing.
+///
+/// The music bus gain moves towards "level" while any sound effect is audible,
+/// and back to 100% when all of them have finished. The gain is updated once
+/// per frame.
+///
+/// @param level
+///     Music gain while effects play. 0->1024 representing 0%->100%. Use 1024
+///     to disable ducking (default).
+/// @param attack
+///     Gain decrease per frame when effects start (0 = instant).
+/// @param release
+///     Gain increase per frame when effects stop (0 = instant).
+void mmSetMusicDucking(mm_word level, mm_word attack, mm_word release);
+
 /// Stop all sound effects and reset the effect system.
 ///
 /// It stops even released effects.
@@ -81,7 +81,7 @@ mm_bool mmIsInitialized(void);
 /// Hardware mixing offers 16-channel audio with minimal CPU load.
 ///
 /// Interpolated mixing extends the capability of the hardware channels by
-/// adding linear interpolation in software.
+/// adding interpolation in software (see mmSetInterpolation()).
 ///
 /// Extended mixing increases the channel count to 30 with software mixing.
 ///
@@ -92,6 +92,103 @@ mm_bool mmIsInitialized(void);
 ///     for interpolated mixing, or MM_MODE_C for extended mixing.
 void mmSelectMode(mm_mode_enum mode);
 
+/// Switches the audio mode for Maxmod DS without stopping the audio.
+///
+/// Unlike mmSelectMode(), the music and sound effects that are playing continue
+/// in the new mode from the position they had in the old one. The switch
+/// happens at the start of the next mixer update.
+///
+/// Sounds that stay in the same hardware channel (between modes A and C) aren't
+/// interrupted. Other sounds are restarted from their position, which is
+/// rounded to a word of sample data. Sounds inside a loop restart from the
+/// start of the loop if they move to a hardware channel, and ADPCM sounds
+/// restart from the beginning. If the new mode has fewer channels than sounds
+/// are playing (for example, when switching from mode C to mode A), the sounds
+/// that don't fit are stopped.
+///
+/// @param mode
+///     New audio mode. Pass MM_MODE_A for complete hardware mixing, MM_MODE_B
+///     for interpolated mixing, or MM_MODE_C for extended mixing.
+void mmSelectModeLive(mm_mode_enum mode);
+
+/// Returns the CPU usage of Maxmod in the ARM7.
+///
+/// The ARM7 starts measuring the first time this function is called, so the
+/// first call returns zeroes. After that, the values are updated every time the
+/// mixer runs.
+///
+/// The times are measured with the mixer timer, which ticks every 256 (mode C)
+/// or 1024 (modes A and B) cycles. Short parts are still measured well on
+/// average, but their peaks are less accurate.
+///
+/// @param load
+///     Pointer to a struct where the values are stored.
+void mmGetARM7Load(mm_arm7_load *load);
+
+/// Selects the interpolation used by the interpolated audio mode (mode B).
+///
+/// It takes effect the next time the mixer runs. It has no effect in modes A
+/// and C. The default is MM_INTERP_LINEAR. The CPU usage documentation lists an
+/// estimate of the cost of each option. The estimates haven't been measured on
+/// hardware; use mmGetARM7Load() to check the real cost.
+///
+/// @param kernel
+///     Interpolation kernel. 8-bit and 16-bit samples are supported by all of
+///     them.
+void mmSetInterpolation(mm_interpolation kernel);
+
+/// Configures the slices of the interpolated audio mode (mode B).
+///
+/// The new configuration is used the next time mmSelectMode() selects mode B.
+/// If mode B is already active, select it again to apply it.
+///
+/// The ARM7 doesn't have a default output buffer. When Maxmod is controlled
+/// from the ARM9 it provides one, but programs that only use the ARM7 API must
+/// set an output buffer before selecting mode B, or mode A is used instead.
+///
+/// @param config
+///     New configuration. Pass NULL to restore the default one.
+///
+/// @return
+///     Returns true on success, false if the configuration isn't valid.
+mm_bool mmSetModeBConfig(const mm_mode_b_config *config);
+
+/// Limits how many channels Maxmod can use in the extended mixing mode (mode C).
+///
+/// Hardware channels are given to Maxmod in order (0 to 5, then 8 to 15), and
+/// software channels are 16 onwards. Channels that aren't used by Maxmod are
+/// locked (see mmLockChannels()), and any sound playing in them is stopped. The
+/// channels locked by this function are unlocked when the mode changes to A or
+/// B. This can be called at any time. If mode C isn't active, it's applied the
+/// next time it is selected.
+///
+/// The default is MM_MODE_C_HW_VOICES_MAX hardware channels and
+/// MM_MODE_C_SW_VOICES_MAX software channels, which are also the limits. This
+/// function can only reduce the number of channels to save CPU time, it can't
+/// add voices past those limits.
+///
+/// @param hardware
+///     Number of hardware channels (0 to MM_MODE_C_HW_VOICES_MAX).
+/// @param software
+///     Number of software channels (0 to MM_MODE_C_SW_VOICES_MAX).
+///
+/// @return
+///     Returns true on success, false if the values are out of range.
+mm_bool mmSetModeCVoices(mm_word hardware, mm_word software);
+
+/// Limits the CPU time spent mixing software channels in mode C.
+///
+/// Before each update, the cost of mixing the audible software channels is
+/// estimated. If it's over the budget, the quietest software channels are
+/// stopped until it fits. Silent channels aren't counted. The cost of each
+/// channel is a fixed estimate (see the CPU usage documentation) that hasn't
+/// been measured on hardware, so check the real usage with mmGetARM7Load().
+///
+/// @param cycles
+///     Maximum ARM7 cycles per mixer update, or 0 to disable the limit
+///     (default).
+void mmSetModeCBudget(mm_word cycles);
+
 /// This is the main routine-function that processes music and updates the sound
 /// output.
 ///
@@ -231,6 +328,21 @@ void mmSetModuleTempo(mm_word tempo);
 ///     Range = 0x200 -> 0x800 = 0.5 -> 2.0
 void mmSetModulePitch(mm_word pitch);
 
+/// Sets how fast the volume and panning of the module channels change.
+///
+/// The DS mixer changes the volume and panning of a channel gradually to avoid
+/// clicks. Volume decreases and panning changes are done in steps of the
+/// specified size every mixer update, out of a full scale of 65535. Volume
+/// increases move a quarter of the remaining distance every update, which
+/// smooths the attack of percussive sounds, unless instant_attack is true.
+///
+/// @param rate
+///     Ramp rate. MM_RAMP_DEFAULT is the default rate, MM_RAMP_OFF disables
+///     ramping (the levels change immediately).
+/// @param instant_attack
+///     If true, volume increases are applied immediately.
+void mmSetModuleRamp(mm_word rate, mm_bool instant_attack);
+
 /// Play individual MAS file from RAM.
 ///
 /// @deprecated
@@ -424,6 +536,19 @@ void mmEffectRate(mm_sfxhand handle, mm_word rate);
 ///     6.10 fixed point factor.
 void mmEffectScaleRate(mm_sfxhand handle, mm_word factor);
 
+/// Sets how fast the panning and the volume decreases of a sound effect change.
+///
+/// Sound effects start at their full volume, and changes done with
+/// mmEffectVolume() are immediate. The rest of changes are done gradually, in
+/// steps of the specified size every mixer update. Every new sound effect uses
+/// MM_RAMP_DEFAULT.
+///
+/// @param handle
+///     Sound effect handle received from mmEffect() or mmEffectEx().
+/// @param rate
+///     Ramp rate (out of a full scale of 65535). MM_RAMP_OFF disables ramping.
+void mmEffectRamp(mm_sfxhand handle, mm_word rate);
+
 /// Stops a sound effect. The handle will be invalidated.
 ///
 /// @note
@@ -455,6 +580,33 @@ void mmEffectRelease(mm_sfxhand handle);
 ///     Master volume. 0->1024 representing 0%->100% volume
 void mmSetEffectsVolume(mm_word volume);
 
+/// Set the volume of a mix bus.
+///
+/// Every voice started by a module layer is mixed into MM_BUS_MUSIC, and every
+/// voice started by mmEffect() or mmEffectEx() is mixed into MM_BUS_EFFECTS.
+/// The bus volume is applied on top of the module and effect volumes.
+///
+/// @param bus
+///     Mix bus to modify.
+/// @param volume
+///     Bus volume. 0->1024 representing 0%->100% volume
+void mmSetBusVolume(mm_bus bus, mm_word volume);
+
+/// Lower the music bus automatically while sound effects are playing.
+///
+/// The music bus gain moves towards "level" while any sound effect is audible,
+/// and back to 100% when all of them have finished. The gain is updated once
+/// per frame.
+///
+/// @param level
+///     Music gain while effects play. 0->1024 representing 0%->100%. Use 1024
+///     to disable ducking (default).
+/// @param attack
+///     Gain decrease per frame when effects start (0 = instant).
+/// @param release
+///     Gain increase per frame when effects stop (0 = instant).
+void mmSetMusicDucking(mm_word level, mm_word attack, mm_word release);
+
 /// Stop all sound effects and reset the effect system.
 ///
 /// It stops even released effects.
@@ -484,31 +636,131 @@ void mmEffectCancelAll(void);
 ///     Work memory, must be aligned.
 void mmStreamOpen(mm_stream* stream, mm_addr wavebuffer, mm_addr workbuffer);
 
+/// Opens an audio stream that writes directly to the wave buffer.
+///
+/// This works like mmStreamOpen(), but the callback in the mm_stream struct is
+/// ignored. The callback receives pointers to the wave buffer, one per output
+/// channel and segment of the ring buffer (see mm_stream_planes), so no work
+/// buffer is needed.
+///
+/// @param stream
+///     Pointer to a structure containing information about how the stream will
+///     operate.
+/// @param callback
+///     Function that writes the samples.
+/// @param wavebuffer
+///     Wave memory, must be aligned.
+void mmStreamOpenPlanar(mm_stream *stream, mm_stream_planar_func callback,
+                        mm_addr wavebuffer);
+
+/// Opens one of several simultaneous audio streams.
+///
+/// mmStreamOpen() opens stream 0. Up to MM_STREAM_MAX streams can be open at
+/// the same time. Each one needs its own hardware timer and uses its own pair
+/// of hardware channels: 4-5 for stream 0, 2-3 for stream 1, 0-1 for stream 2
+/// and 8-9 for stream 3 (mono streams only use the first channel of the pair).
+///
+/// @param id
+///     Stream index (0 to MM_STREAM_MAX - 1).
+/// @param stream
+///     Pointer to a structure containing information about how the stream will
+///     operate.
+/// @param wavebuffer
+///     Wave memory, must be aligned.
+/// @param workbuffer
+///     Work memory, must be aligned.
+///
+/// @return
+///     It returns true on success, false on error (invalid stream index or
+///     timer, or stream or timer already in use).
+mm_bool mmStreamOpenEx(mm_word id, mm_stream *stream, mm_addr wavebuffer, mm_addr workbuffer);
+
+/// Opens one of several simultaneous audio streams that writes directly to the
+/// wave buffer.
+///
+/// See mmStreamOpenPlanar() and mmStreamOpenEx().
+///
+/// @param id
+///     Stream index (0 to MM_STREAM_MAX - 1).
+/// @param stream
+///     Pointer to a structure containing information about how the stream will
+///     operate.
+/// @param callback
+///     Function that writes the samples.
+/// @param wavebuffer
+///     Wave memory, must be aligned.
+///
+/// @return
+///     It returns true on success, false on error (invalid stream index or
+///     timer, or stream or timer already in use).
+mm_bool mmStreamOpenPlanarEx(mm_word id, mm_stream *stream, mm_stream_planar_func callback,
+                             mm_addr wavebuffer);
+
 /// Check buffering state and fill stream with data.
 ///
 /// Requests will be made to your callback to fill parts of the wave buffer(s).
 /// This function only needs to be called manually if the stream isn't in
 /// auto-fill mode. This function shouldn't be used when the stream is
 /// automatically filled.
+///
+/// It updates all the open streams that are in manual mode.
 void mmStreamUpdate(void);
 
+/// Check buffering state and fill one stream with data.
+///
+/// This works like mmStreamUpdate(), but it only updates one stream.
+///
+/// @param id
+///     Stream index (0 to MM_STREAM_MAX - 1).
+void mmStreamUpdateEx(mm_word id);
+
 /// Close audio stream.
+///
+/// This closes stream 0.
 void mmStreamClose(void);
 
+/// Close an audio stream opened with mmStreamOpenEx().
+///
+/// @param id
+///     Stream index (0 to MM_STREAM_MAX - 1).
+void mmStreamCloseEx(mm_word id);
+
 /// Get number of samples elapsed since the stream was opened.
 ///
-/// The 32-bit value will wrap every 36 hours or so (at 32khz).
+/// The 32-bit value will wrap every 36 hours or so (at 32khz). This returns
+/// the position of stream 0.
 ///
 /// @return
 ///     The nummber of samples.
 mm_word mmStreamGetPosition(void);
 
+/// Get number of samples elapsed since a stream was opened.
+///
+/// @param id
+///     Stream index (0 to MM_STREAM_MAX - 1).
+///
+/// @return
+///     The nummber of samples.
+mm_word mmStreamGetPositionEx(mm_word id);
+
 /// Changes the volume of the audio stream.
 ///
+/// This changes the volume of stream 0.
+///
 /// @param volume
 ///     New volume level. Ranges from 0 (silent) to 127 (normal).
 void mmStreamVolume(mm_byte volume);
 
+/// Changes the volume of an audio stream.
+///
+/// The volume is kept if the stream is closed and opened again.
+///
+/// @param id
+///     Stream index (0 to MM_STREAM_MAX - 1).
+/// @param volume
+///     New volume level. Ranges from 0 (silent) to 127 (normal).
+void mmStreamVolumeEx(mm_word id, mm_byte volume);
+
 // ***************************************************************************
 /// @}
 /// @defgroup nds_arm7_reverb NDS: ARM7 Reverb
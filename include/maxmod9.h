@@ -120,7 +120,7 @@ bool mmInit(mm_ds_system *system);
 /// Hardware mixing offers 16-channel audio with minimal CPU load.
 ///
 /// Interpolated mixing extends the capability of the hardware channels by
-/// adding linear interpolation in software.
+/// adding interpolation in software (see mmSetInterpolation()).
 ///
 /// Extended mixing increases the channel count to 30 with software mixing.
 ///
@@ -131,6 +131,122 @@ bool mmInit(mm_ds_system *system);
 ///     for interpolated mixing, or MM_MODE_C for extended mixing.
 void mmSelectMode(mm_mode_enum mode);
 
+/// Switches the audio mode for Maxmod DS without stopping the audio.
+///
+/// Unlike mmSelectMode(), the music and sound effects that are playing continue
+/// in the new mode from the position they had in the old one. The switch
+/// happens at the start of the next mixer update.
+///
+/// Sounds that stay in the same hardware channel (between modes A and C) aren't
+/// interrupted. Other sounds are restarted from their position, which is
+/// rounded to a word of sample data. Sounds inside a loop restart from the
+/// start of the loop if they move to a hardware channel, and ADPCM sounds
+/// restart from the beginning. If the new mode has fewer channels than sounds
+/// are playing (for example, when switching from mode C to mode A), the sounds
+/// that don't fit are stopped.
+///
+/// @param mode
+///     New audio mode. Pass MM_MODE_A for complete hardware mixing, MM_MODE_B
+///     for interpolated mixing, or MM_MODE_C for extended mixing.
+void mmSelectModeLive(mm_mode_enum mode);
+
+/// Returns the CPU usage of Maxmod in the ARM7.
+///
+/// The ARM7 starts measuring the first time this function is called, so the
+/// first call returns zeroes. After that, the values are updated every time the
+/// mixer runs. Use them to see how close the ARM7 is to not finishing an update
+/// in time, which causes crackles in the audio.
+///
+/// The times are measured with the mixer timer, which ticks every 256 (mode C)
+/// or 1024 (modes A and B) cycles. Short parts are still measured well on
+/// average, but their peaks are less accurate.
+///
+/// The number of commands sent by the ARM9 that the ARM7 has handled is
+/// counted as well, together with the highest number of commands handled in
+/// one update. These are only counters: they don't measure how long it takes
+/// for a command to be handled after the ARM9 sends it.
+///
+/// @param load
+///     Pointer to a struct where the values are stored.
+void mmGetARM7Load(mm_arm7_load *load);
+
+/// Returns the state of Maxmod in the ARM7.
+///
+/// The first time this function is called, the ARM7 is asked to publish its
+/// state in main RAM at every mixer update. The ARM9 reads it without sending
+/// any message to the ARM7, so this function can be called as often as needed.
+/// From then on, the ARM7 stops sending the update message used by mmActive(),
+/// mmGetPosition() and similar functions once per update, and they read the
+/// published state instead. mmEffectActive() uses it as well.
+///
+/// @param status
+///     Pointer to a struct where the state is stored.
+///
+/// @return
+///     It returns false if the ARM7 hasn't published its state yet (the struct
+///     isn't modified), true otherwise.
+mm_bool mmGetARM7Status(mm_arm7_status *status);
+
+/// Selects the interpolation used by the interpolated audio mode (mode B).
+///
+/// It takes effect the next time the mixer runs. It has no effect in modes A
+/// and C. The default is MM_INTERP_LINEAR. The CPU usage documentation lists an
+/// estimate of the cost of each option. The estimates haven't been measured on
+/// hardware; use mmGetARM7Load() to check the real cost.
+///
+/// @param kernel
+///     Interpolation kernel. 8-bit and 16-bit samples are supported by all of
+///     them.
+void mmSetInterpolation(mm_interpolation kernel);
+
+/// Configures the slices of the interpolated audio mode (mode B).
+///
+/// The new configuration is used the next time mmSelectMode() selects mode B.
+/// If mode B is already active, select it again to apply it.
+///
+/// @param config
+///     New configuration. Pass NULL to restore the default one.
+///
+/// @return
+///     Returns true on success, false if the configuration isn't valid.
+mm_bool mmSetModeBConfig(const mm_mode_b_config *config);
+
+/// Limits how many channels Maxmod can use in the extended mixing mode (mode C).
+///
+/// Hardware channels are given to Maxmod in order (0 to 5, then 8 to 15), and
+/// software channels are 16 onwards. Channels that aren't used by Maxmod are
+/// locked (see mmLockChannels()), and any sound playing in them is stopped. The
+/// channels locked by this function are unlocked when the mode changes to A or
+/// B. This can be called at any time. If mode C isn't active, it's applied the
+/// next time it is selected.
+///
+/// The default is MM_MODE_C_HW_VOICES_MAX hardware channels and
+/// MM_MODE_C_SW_VOICES_MAX software channels, which are also the limits. This
+/// function can only reduce the number of channels to save CPU time, it can't
+/// add voices past those limits.
+///
+/// @param hardware
+///     Number of hardware channels (0 to MM_MODE_C_HW_VOICES_MAX).
+/// @param software
+///     Number of software channels (0 to MM_MODE_C_SW_VOICES_MAX).
+///
+/// @return
+///     Returns true on success, false if the values are out of range.
+mm_bool mmSetModeCVoices(mm_word hardware, mm_word software);
+
+/// Limits the CPU time spent mixing software channels in mode C.
+///
+/// Before each update, the cost of mixing the audible software channels is
+/// estimated. If it's over the budget, the quietest software channels are
+/// stopped until it fits. Silent channels aren't counted. The cost of each
+/// channel is a fixed estimate (see the CPU usage documentation) that hasn't
+/// been measured on hardware, so check the real usage with mmGetARM7Load().
+///
+/// @param cycles
+///     Maximum ARM7 cycles per mixer update, or 0 to disable the limit
+///     (default).
+void mmSetModeCBudget(mm_word cycles);
+
 /// Loads a module into memory for playback.
 ///
 /// Must be used before starting to play a module with mmStart(). If the
@@ -226,6 +342,33 @@ void mmSetEventHandler(mm_callback handler);
 ///     Function pointer to the event handler currently installed.
 mm_callback mmGetEventHandler(void);
 
+/// Calls the event handler for all song events queued by the ARM7.
+///
+/// By default the ARM7 sends each song event to the ARM9 as soon as it happens,
+/// and the event handler is called from the FIFO interrupt handler. The first
+/// time this function (or mmReadEvent()) is called, the ARM7 is asked to write
+/// the events to a queue in main RAM instead. From then on the event handler
+/// is only called from this function, so it can be called from the main loop.
+///
+/// The queue can hold 85 events. If it's full, new events are lost.
+///
+/// @return
+///     Number of events handled.
+mm_word mmPollEvents(void);
+
+/// Removes the oldest song event from the queue of events.
+///
+/// This works like mmPollEvents(), but the event handler isn't called. The
+/// event is returned with the position of the module and the time when it
+/// happened instead.
+///
+/// @param event
+///     Pointer to a struct where the event is stored.
+///
+/// @return
+///     It returns false if the queue is empty, true otherwise.
+mm_bool mmReadEvent(mm_song_event *event);
+
 /// Setup the standard interface for a soundbank that is loaded in the file
 /// system.
 ///
@@ -264,6 +407,74 @@ void mmSoundBankInMemory(mm_addr address);
 ///     Function pointer to soundbank request handler.
 void mmSetCustomSoundBankHandler(mm_callback p_loader);
 
+/// Starts packing the commands sent to the ARM7 together.
+///
+/// Normally, every function that sends a command to the ARM7 sends its own
+/// FIFO message. After calling this function, commands are packed into as few
+/// FIFO messages as possible until mmCommitBatch() is called. Changes of the
+/// volume, panning and rate of the same sound effect handle are merged, and
+/// only the last value of each one is sent.
+///
+/// To batch all the commands of a frame, call this function at the start of
+/// the frame and mmCommitBatch() at the end. Functions that need an answer from
+/// the ARM7 (like mmEffect()) send the commands that are pending before
+/// waiting.
+///
+/// @warning
+///     Don't call Maxmod functions from interrupt handlers while a batch is
+///     open.
+void mmBeginBatch(void);
+
+/// Sends all commands packed since mmBeginBatch() and stops packing commands.
+void mmCommitBatch(void);
+
+/// Makes the ARM7 run the following commands at a specific time.
+///
+/// Normally the ARM7 runs a command at the first mixer update after it
+/// arrives, so the time when it's heard depends on when the ARM9 sent it. After
+/// calling this function, the ARM7 keeps the commands until the mixer clock
+/// reaches the specified time, and runs them at the start of that mixer update.
+/// The current value of the clock is returned by mmGetARM7Status(), and song
+/// events have the value of the clock when they happened (see mmReadEvent()).
+///
+/// This works with any command, like mmEffectEx(), mmStart(),
+/// mmSetPositionEx() or mmSetModuleVolume(). mmEffect() and mmEffectEx()
+/// allocate the handle in the ARM9, like after mmEnableAsyncEffects(), because
+/// the effect doesn't exist until it's scheduled to start. Other functions that
+/// wait for an answer from the ARM7, like mmLoad(), wait until the command has
+/// been run.
+///
+/// Commands whose time has already passed are run at the next mixer update.
+/// The ARM7 can hold 32 commands waiting for their time. If there are more,
+/// new commands are run right away.
+///
+/// @param time
+///     Mixer clock value, in ticks of a timer with a prescaler of 1024 (about
+///     32.7 kHz).
+void mmBeginSchedule(mm_word time);
+
+/// Makes the ARM7 run the following commands as soon as possible.
+void mmEndSchedule(void);
+
+/// Sends all future commands to the ARM7 through a ring buffer in main RAM.
+///
+/// By default, commands are sent through the FIFO. The ARM7 copies them byte
+/// by byte to a queue in its FIFO interrupt handler, and reads them back later
+/// with interrupts disabled. After calling this function, the ARM9 writes the
+/// commands to a ring buffer shared by both CPUs, and the ARM7 reads them
+/// directly from it at the start of every mixer update, without any FIFO
+/// interrupt or critical section.
+///
+/// The FIFO is still used for the answers of the ARM7, like sound effect
+/// handles. It isn't possible to go back to the FIFO afterwards.
+///
+/// @note
+///     If the ring buffer is full, functions that send commands wait until the
+///     ARM7 has read enough of them. Interrupts are only disabled while a
+///     command is written to the ring, not while waiting, so commands can still
+///     be sent from interrupt handlers.
+void mmEnableCommandRing(void);
+
 /// Returns the number of modules available in the soundbank.
 ///
 /// @return
@@ -394,12 +605,36 @@ void mmSetModuleTempo(mm_word tempo);
 ///     New pitch scale. Value = 1024 * 2 ^ (semitones / 12)
 void mmSetModulePitch(mm_word pitch);
 
+/// Sets how fast the volume and panning of the module channels change.
+///
+/// The DS mixer changes the volume and panning of a channel gradually to avoid
+/// clicks. Volume decreases and panning changes are done in steps of the
+/// specified size every mixer update, out of a full scale of 65535. Volume
+/// increases move a quarter of the remaining distance every update, which
+/// smooths the attack of percussive sounds, unless instant_attack is true.
+///
+/// @param rate
+///     Ramp rate. MM_RAMP_DEFAULT is the default rate, MM_RAMP_OFF disables
+///     ramping (the levels change immediately).
+/// @param instant_attack
+///     If true, volume increases are applied immediately.
+void mmSetModuleRamp(mm_word rate, mm_bool instant_attack);
+
 /// Used to determine if a module is playing.
 ///
 /// @return
 ///     Nonzero if a module is currently playing.
 mm_bool mmActive(void);
 
+/// Get current tick being played.
+///
+/// The first call sets up the status block used by mmGetARM7Status(), so it
+/// returns 0 until the ARM7 has published it.
+///
+/// @return
+///     The current tick.
+mm_word mmGetPositionTick(void);
+
 /// Get current row being played.
 ///
 /// @return
@@ -534,6 +769,38 @@ mm_sfxhand mmEffect(mm_word sample_ID);
 ///     the sound effect while it is playing. On error, MM_SFXHAND_INVALID.
 mm_sfxhand mmEffectEx(mm_sound_effect *sound);
 
+/// Makes mmEffect() and mmEffectEx() return without waiting for the ARM7.
+///
+/// By default, mmEffect() and mmEffectEx() wait until the ARM7 has started the
+/// effect and sent its handle back. After calling this function, the handles
+/// are allocated by the ARM9 in a separate set of 16 effect channels, and the
+/// functions return right away.
+///
+/// The handle is valid even if the ARM7 can't play the effect (for example, if
+/// there are no free channels). In that case the other effect functions simply
+/// ignore it. An effect channel can only be used again after the ARM7 has
+/// reported that its effect has ended, so mmEffect() and mmEffectEx() return
+/// MM_SFXHAND_INVALID if 16 effects started this way are still playing.
+///
+/// When a handle is passed to mmEffectEx() to recycle it, the returned handle
+/// is different from the old one.
+void mmEnableAsyncEffects(void);
+
+/// Indicates if a sound effect is active or not.
+///
+/// The state of handles allocated by the ARM9 (see mmEnableAsyncEffects()) is
+/// known by the ARM9. For other handles the state published by the ARM7 is used
+/// (see mmGetARM7Status()). An effect that has just been started is reported
+/// as active until the ARM7 has published a state that includes it, so it's
+/// safe to call this function right after mmEffect() or mmEffectEx().
+///
+/// @param handle
+///     Sound effect handle received from mmEffect() or mmEffectEx().
+///
+/// @return
+///     True if the effect is active, false if not.
+mm_bool mmEffectActive(mm_sfxhand handle);
+
 /// Changes the volume of a sound effect.
 ///
 /// @param handle
@@ -573,6 +840,19 @@ void mmEffectRate(mm_sfxhand handle, mm_word rate);
 ///     6.10 fixed point factor.
 void mmEffectScaleRate(mm_sfxhand handle, mm_word factor);
 
+/// Sets how fast the panning and the volume decreases of a sound effect change.
+///
+/// Sound effects start at their full volume, and changes done with
+/// mmEffectVolume() are immediate. The rest of changes are done gradually, in
+/// steps of the specified size every mixer update. Every new sound effect uses
+/// MM_RAMP_DEFAULT.
+///
+/// @param handle
+///     Sound effect handle received from mmEffect() or mmEffectEx().
+/// @param rate
+///     Ramp rate (out of a full scale of 65535). MM_RAMP_OFF disables ramping.
+void mmEffectRamp(mm_sfxhand handle, mm_word rate);
+
 /// Stops a sound effect. The handle will be invalidated.
 ///
 /// @note
@@ -612,6 +892,33 @@ mm_sfxhand mmEffectExt(mm_sound_effect *sound, mm_ds_sample *sample);
 ///     Master volume. 0->1024 representing 0%->100% volume
 void mmSetEffectsVolume(mm_word volume);
 
+/// Set the volume of a mix bus.
+///
+/// Every voice started by a module layer is mixed into MM_BUS_MUSIC, and every
+/// voice started by mmEffect() or mmEffectEx() is mixed into MM_BUS_EFFECTS.
+/// The bus volume is applied on top of the module and effect volumes.
+///
+/// @param bus
+///     Mix bus to modify.
+/// @param volume
+///     Bus volume. 0->1024 representing 0%->100% volume
+void mmSetBusVolume(mm_bus bus, mm_word volume);
+
+/// Lower the music bus automatically while sound effects are playing.
+///
+/// The music bus gain moves towards "level" while any sound effect is audible,
+/// and back to 100% when all of them have finished. The gain is updated once
+/// per frame.
+///
+/// @param level
+///     Music gain while effects play. 0->1024 representing 0%->100%. Use 1024
+///     to disable ducking (default).
+/// @param attack
+///     Gain decrease per frame when effects start (0 = instant).
+/// @param release
+///     Gain increase per frame when effects stop (0 = instant).
+void mmSetMusicDucking(mm_word level, mm_word attack, mm_word release);
+
 /// Stop all sound effects and reset the effect system.
 ///
 /// It stops even released effects.
@@ -642,31 +949,229 @@ void mmEffectCancelAll(void);
 ///     operate.
 void mmStreamOpen(mm_stream *stream);
 
+/// Opens an audio stream that writes directly to the wave buffer.
+///
+/// This works like mmStreamOpen(), but the callback in the mm_stream struct is
+/// ignored. Instead of writing interleaved samples to a work buffer that is
+/// then copied and de-interleaved into the wave buffer, the callback receives
+/// pointers to the wave buffer, one per output channel and segment of the ring
+/// buffer (see mm_stream_planes). Only the part of the buffer that has been
+/// written is flushed from the data cache.
+///
+/// @param stream
+///     Pointer to a structure containing information about how the stream will
+///     operate.
+/// @param callback
+///     Function that writes the samples.
+void mmStreamOpenPlanar(mm_stream *stream, mm_stream_planar_func callback);
+
+/// Opens one of several simultaneous audio streams.
+///
+/// mmStreamOpen() opens stream 0. Up to MM_STREAM_MAX streams can be open at
+/// the same time. Each one needs its own hardware timer and uses its own pair
+/// of hardware channels: 4-5 for stream 0, 2-3 for stream 1, 0-1 for stream 2
+/// and 8-9 for stream 3 (mono streams only use the first channel of the pair).
+///
+/// @param id
+///     Stream index (0 to MM_STREAM_MAX - 1).
+/// @param stream
+///     Pointer to a structure containing information about how the stream will
+///     operate.
+///
+/// @return
+///     It returns true on success, false on error (invalid stream index or
+///     timer, stream or timer already in use, or out of memory).
+mm_bool mmStreamOpenEx(mm_word id, mm_stream *stream);
+
+/// Opens one of several simultaneous audio streams that writes directly to the
+/// wave buffer.
+///
+/// See mmStreamOpenPlanar() and mmStreamOpenEx().
+///
+/// @param id
+///     Stream index (0 to MM_STREAM_MAX - 1).
+/// @param stream
+///     Pointer to a structure containing information about how the stream will
+///     operate.
+/// @param callback
+///     Function that writes the samples.
+///
+/// @return
+///     It returns true on success, false on error (invalid stream index or
+///     timer, stream or timer already in use, or out of memory).
+mm_bool mmStreamOpenPlanarEx(mm_word id, mm_stream *stream, mm_stream_planar_func callback);
+
 /// Check buffering state and fill stream with data.
 ///
 /// Requests will be made to your callback to fill parts of the wave buffer(s).
 /// This function only needs to be called manually if the stream isn't in
 /// auto-fill mode. This function shouldn't be used when the stream is
 /// automatically filled.
+///
+/// It updates all the open streams that are in manual mode.
 void mmStreamUpdate(void);
 
+/// Check buffering state and fill one stream with data.
+///
+/// This works like mmStreamUpdate(), but it only updates one stream.
+///
+/// @param id
+///     Stream index (0 to MM_STREAM_MAX - 1).
+void mmStreamUpdateEx(mm_word id);
+
 /// Close audio stream.
+///
+/// This closes stream 0.
 void mmStreamClose(void);
 
+/// Close an audio stream opened with mmStreamOpenEx().
+///
+/// @param id
+///     Stream index (0 to MM_STREAM_MAX - 1).
+void mmStreamCloseEx(mm_word id);
+
 /// Get number of samples elapsed since the stream was opened.
 ///
-/// The 32-bit value will wrap every 36 hours or so (at 32khz).
+/// The 32-bit value will wrap every 36 hours or so (at 32khz). This returns
+/// the position of stream 0.
 ///
 /// @return
 ///     The nummber of samples.
 mm_word mmStreamGetPosition(void);
 
+/// Get number of samples elapsed since a stream was opened.
+///
+/// @param id
+///     Stream index (0 to MM_STREAM_MAX - 1).
+///
+/// @return
+///     The nummber of samples.
+mm_word mmStreamGetPositionEx(mm_word id);
+
 /// Changes the volume of the audio stream.
 ///
+/// This changes the volume of stream 0.
+///
 /// @param volume
 ///     New volume level. Ranges from 0 (silent) to 127 (normal).
 void mmStreamVolume(mm_byte volume);
 
+/// Changes the volume of an audio stream.
+///
+/// The volume is kept if the stream is closed and opened again.
+///
+/// @param id
+///     Stream index (0 to MM_STREAM_MAX - 1).
+/// @param volume
+///     New volume level. Ranges from 0 (silent) to 127 (normal).
+void mmStreamVolumeEx(mm_word id, mm_byte volume);
+
+// ***************************************************************************
+/// @}
+/// @defgroup nds_arm9_softmix NDS: ARM9 Software Mixer
+/// @{
+// ***************************************************************************
+
+/// Starts the ARM9 software mixer.
+///
+/// The software mixer plays sound effects on the ARM9 and outputs them through
+/// the audio stream, so that they don't use any hardware channel or ARM7 CPU
+/// time. This is useful when there are more voices than hardware channels, or
+/// when mode C can't keep up with the song. Up to MM_SOFT_VOICES effects can be
+/// mixed at the same time.
+///
+/// The audio stream is opened in automatic mode with a 16-bit stereo format,
+/// so it can't be used for anything else while the software mixer is active.
+/// Samples are mixed with linear interpolation. IMA-ADPCM samples aren't
+/// supported.
+///
+/// @param stream_id
+///     Index of the audio stream to use (0 to MM_STREAM_MAX - 1). See
+///     mmStreamOpenEx().
+/// @param sampling_rate
+///     Output rate in Hz. Higher rates sound better but use more CPU time.
+/// @param buffer_length
+///     Length of the stream buffer in samples. See mm_stream.
+/// @param timer
+///     Hardware timer used by the stream.
+///
+/// @return
+///     It returns true on success, false on error (for example, if the stream
+///     or the timer are already in use).
+mm_bool mmSoftMixOpen(mm_word stream_id, mm_word sampling_rate, mm_word buffer_length,
+                      mm_stream_timer timer);
+
+/// Stops all software mixed effects and closes the audio stream.
+void mmSoftMixClose(void);
+
+/// Plays a sound effect with the software mixer at its default settings.
+///
+/// @param sample_ID
+///     ID of sample to play. The sample must have been loaded with
+///     mmLoadEffect().
+///
+/// @return
+///     Handle of the effect. On error, MM_SFXHAND_INVALID.
+mm_sfxhand mmSoftEffect(mm_word sample_ID);
+
+/// Plays a sound effect with the software mixer with the specified settings.
+///
+/// Handles of the software mixer can only be used with the mmSoftEffect*()
+/// functions.
+///
+/// @param sound
+///     Sound effect attributes. External samples must be in main RAM.
+///
+/// @return
+///     Handle of the effect. On error, MM_SFXHAND_INVALID.
+mm_sfxhand mmSoftEffectEx(mm_sound_effect *sound);
+
+/// Stops a software mixed sound effect.
+///
+/// @param handle
+///     Sound effect handle.
+void mmSoftEffectCancel(mm_sfxhand handle);
+
+/// Changes the volume of a software mixed sound effect.
+///
+/// @param handle
+///     Sound effect handle.
+/// @param volume
+///     Effect volume ranging from 0..255 (0 = silent, 255 = normal).
+void mmSoftEffectVolume(mm_sfxhand handle, mm_word volume);
+
+/// Changes the panning of a software mixed sound effect.
+///
+/// @param handle
+///     Sound effect handle.
+/// @param panning
+///     Effect panning ranging from 0..255 (0 = left, 128 = center, 255 =
+///     right).
+void mmSoftEffectPanning(mm_sfxhand handle, mm_byte panning);
+
+/// Changes the playback rate of a software mixed sound effect.
+///
+/// @param handle
+///     Sound effect handle.
+/// @param rate
+///     Playback rate. 6.10 fixed point number (1024 = original rate).
+void mmSoftEffectRate(mm_sfxhand handle, mm_word rate);
+
+/// Checks if a software mixed sound effect is still playing.
+///
+/// @param handle
+///     Sound effect handle.
+///
+/// @return
+///     It returns true if the effect is playing, false otherwise.
+mm_bool mmSoftEffectActive(mm_sfxhand handle);
+
+/// Returns the number of voices currently used by the software mixer.
+///
+/// @return
+///     Number of active voices.
+mm_word mmSoftMixActiveVoices(void);
+
 // ***************************************************************************
 /// @}
 /// @defgroup nds_arm9_reverb NDS: ARM9 Reverb
@@ -62,6 +62,163 @@ typedef enum
     MM_MODE_C  ///< Selects the extended mixing audio mode.
 } mm_mode_enum;
 
+/// Interpolation used by the software resampler of the DS audio mode B. Pass to
+/// mmSetInterpolation().
+typedef enum
+{
+    /// No interpolation. Lowest CPU usage.
+    MM_INTERP_NEAREST = 0,
+    /// Linear interpolation for samples played below the output rate, no
+    /// interpolation above it (default).
+    MM_INTERP_LINEAR  = 1,
+    /// 4-point cubic Hermite interpolation at all rates. Highest CPU usage.
+    MM_INTERP_CUBIC   = 2
+} mm_interpolation;
+
+/// Minimum number of samples of a mode B slice.
+#define MM_MODE_B_SLICE_MIN     64
+/// Maximum number of samples of a mode B slice.
+#define MM_MODE_B_SLICE_MAX     1024
+/// Maximum number of slices in the output buffer of mode B.
+#define MM_MODE_B_SLICES_MAX    8
+
+/// Maximum number of hardware channels used by Maxmod in mode C. Channels 6 and
+/// 7 output the software mixed audio.
+#define MM_MODE_C_HW_VOICES_MAX 14
+/// Maximum number of software mixed channels in mode C. The mixer has 32
+/// channels in total, so this can't be increased.
+#define MM_MODE_C_SW_VOICES_MAX 16
+
+/// Default volume and panning ramp rate of the DS mixer. See mmSetModuleRamp()
+/// and mmEffectRamp().
+#define MM_RAMP_DEFAULT 6144
+/// Disables volume and panning ramping in the DS mixer.
+#define MM_RAMP_OFF 0
+
+/// Number of voices of the ARM9 software mixer. See mmSoftMixOpen().
+#define MM_SOFT_VOICES 16
+
+/// Number of audio streams that can be open at the same time on the DS. See
+/// mmStreamOpenEx().
+#define MM_STREAM_MAX 4
+
+/// Configuration of the interpolated audio mode (mode B) of the DS. Pass to
+/// mmSetModeBConfig().
+///
+/// The output buffer of each channel is split into slices. Every time the mixer
+/// runs it resamples one slice per channel, while the hardware plays the rest.
+/// Smaller slices reduce the latency, and larger slices reduce the overhead of
+/// each mixer update. More slices add latency but give the mixer more time
+/// before the hardware catches up with it.
+typedef struct
+{
+    /// Samples in each slice. It must be a multiple of 32, between
+    /// MM_MODE_B_SLICE_MIN and MM_MODE_B_SLICE_MAX. Default: 128.
+    mm_hword slice_length;
+
+    /// Number of slices. It must be between 2 and MM_MODE_B_SLICES_MAX.
+    /// Default: 2.
+    mm_hword slice_count;
+
+    /// Output buffer of 16 * slice_length * slice_count 16-bit samples, aligned
+    /// to 4 bytes. It can be in main RAM. If it's NULL, the ARM9 allocates a
+    /// default buffer of 8 KB in main RAM the first time that mode B is
+    /// selected, which requires slice_length * slice_count to be 256 or
+    /// smaller.
+    mm_addr output;
+} mm_mode_b_config;
+
+/// Parts of Maxmod measured by mmGetARM7Load()
+typedef enum
+{
+    /// Total time spent in the timer interrupt of Maxmod
+    MM_LOAD_FRAME = 0,
+    /// Copy of the new channel settings to the sound registers
+    MM_LOAD_MIXER_PRE = 1,
+    /// Module and jingle playback
+    MM_LOAD_PLAYER = 2,
+    /// Mixer update, including MM_LOAD_SOFTWARE_MIX
+    MM_LOAD_MIXER = 3,
+    /// Software mixing of modes B and C
+    MM_LOAD_SOFTWARE_MIX = 4,
+    /// Handling of the commands sent by the ARM9
+    MM_LOAD_COMMS = 5,
+
+    /// Number of parts that are measured
+    MM_LOAD_COUNT
+} mm_load_part;
+
+/// CPU usage of one part of Maxmod in the ARM7.
+///
+/// The values are percentages of the time between two mixer updates, in
+/// hundredths of a percent (10000 means that it uses all the available time).
+typedef struct {
+    /// Average of the last updates (exponential moving average)
+    mm_hword average;
+    /// Highest value of the last 64 to 128 updates
+    mm_hword peak;
+} mm_load_value;
+
+/// ARM7 CPU usage of Maxmod, returned by mmGetARM7Load().
+typedef struct {
+    /// Usage of each part of Maxmod, indexed by mm_load_part.
+    mm_load_value part[MM_LOAD_COUNT];
+    /// Number of commands handled since the ARM7 started measuring
+    mm_word commands;
+    /// Highest number of commands handled in one update in the last 64 to 128
+    /// updates
+    mm_hword commands_peak;
+} mm_arm7_load;
+
+/// Playback state of a module layer, part of mm_arm7_status.
+typedef struct {
+    /// Current tick of the row
+    mm_byte     tick;
+    /// Current row of the pattern
+    mm_byte     row;
+    /// Current position in the sequence
+    mm_byte     position;
+    /// Ticks per row
+    mm_byte     speed;
+    /// Tempo in BPM
+    mm_byte     tempo;
+    /// True if the layer is playing
+    mm_bool     playing;
+} mm_layer_status;
+
+/// State of Maxmod in the ARM7, returned by mmGetARM7Status().
+typedef struct {
+    /// State of the main module
+    mm_layer_status main;
+    /// State of the jingle
+    mm_layer_status jingle;
+    /// Mixer channels that are playing a sound (one bit per channel)
+    mm_word         active_channels;
+    /// Number of mixer updates since the status started being published
+    mm_word         update_count;
+    /// Time mixed by the ARM7, in the same units as mm_song_event.time
+    mm_word         clock;
+} mm_arm7_status;
+
+/// Song event queued by the ARM7, returned by mmReadEvent().
+typedef struct {
+    /// Event type (MMCB_SONGMESSAGE or MMCB_SONGFINISHED)
+    mm_byte         msg;
+    /// Event parameter (see mm_callback)
+    mm_byte         param;
+    /// Layer that generated the event (MM_MAIN or MM_JINGLE)
+    mm_byte         layer;
+    /// Tick of the row when the event happened
+    mm_byte         tick;
+    /// Row when the event happened
+    mm_byte         row;
+    /// Position in the sequence when the event happened
+    mm_byte         position;
+    /// Time of the mixer update that contains the event, in ticks of a timer
+    /// with a prescaler of 1024 (about 32.7 kHz) since the mixer was started.
+    mm_word         time;
+} mm_song_event;
+
 /// Layer types
 typedef enum
 {
@@ -78,6 +235,20 @@ typedef enum
 }
 mm_layer_type;
 
+/// Mix buses. Each voice is assigned to one of them when it starts playing.
+typedef enum
+{
+    /// Module layers (main module and jingle).
+    MM_BUS_MUSIC = 0,
+
+    /// Sound effects started with mmEffect() and mmEffectEx().
+    MM_BUS_EFFECTS = 1,
+
+    /// Number of mix buses.
+    MM_BUS_COUNT
+}
+mm_bus;
+
 /// Formats for software streaming.
 ///
 /// ADPCM streaming is not supported by the DS hardware. The loop point data
@@ -117,6 +288,37 @@ typedef void (*mm_voidfunc)(void);
 /// @param format Stream format.
 typedef mm_word (*mm_stream_func)(mm_word length, mm_addr dest, mm_stream_formats format);
 
+/// Destination of the samples requested by a planar stream callback (DS mode).
+///
+/// The wave buffer of the stream is a ring, so the requested samples can be
+/// split in two segments: the end of the buffer and its start. Each segment has
+/// one pointer per output channel. The samples of a channel aren't interleaved
+/// with the samples of the other channel.
+typedef struct {
+    /// Number of samples of each segment. The second one is 0 if the samples
+    /// don't wrap around the end of the buffer.
+    mm_word     length[2];
+    /// Destination of the left channel (or the only channel of mono streams)
+    /// in each segment.
+    mm_addr     left[2];
+    /// Destination of the right channel in each segment. NULL in mono streams.
+    mm_addr     right[2];
+} mm_stream_planes;
+
+/// Function pointer definition for handling planar stream fill requests (DS
+/// mode).
+///
+/// The callback must fill the first segment before starting with the second
+/// one.
+///
+/// @param length Number of samples to write to the output.
+/// @param planes Output addresses.
+/// @param format Stream format.
+///
+/// @return Number of samples written.
+typedef mm_word (*mm_stream_planar_func)(mm_word length, const mm_stream_planes *planes,
+                                         mm_stream_formats format);
+
 /// Reverb configuration flags.
 ///
 /// The first few flags enable the values in the mm_reverb_cfg struct (to be
@@ -282,11 +484,22 @@ typedef struct t_mmsoundeffect
 ///
 /// About the wave buffer: The wave buffer is a not-so-heavily used area of
 /// memory and can be placed in EWRAM. The wave buffer contains the final
-/// waveform data that is DMA copied to the sound FIFO. The size of the waveform
-/// buffer must be equal to the size of the mixing buffer. By default, in most
-/// GBA toolchains, the malloc function can be used to allocate the wave buffer
-/// in EWRAM. The wave buffer must be aligned by 4 bytes too (malloc returns
+/// waveform data that is DMA copied to the sound FIFO. By default it holds two
+/// frames of audio, and its size must be equal to the size of the mixing
+/// buffer. If wave_frames is used, the size must be the size of the mixing
+/// buffer multiplied by ``wave_frames / 2``. By default, in most GBA
+/// toolchains, the malloc function can be used to allocate the wave buffer in
+/// EWRAM. The wave buffer must be aligned by 4 bytes too (malloc returns
 /// pointers aligned to 4 bytes).
+///
+/// About output buffering: The wave buffer is split in chunks. mmFrame() mixes
+/// all the chunks that are missing between the chunk being played and
+/// ``mix_ahead`` chunks after it. More frames in the wave buffer let the mixer
+/// build up a reserve of audio so that a missed call to mmFrame() doesn't
+/// replay old audio. Smaller chunks (and a smaller ``mix_ahead``) reduce the
+/// latency, but mmFrame() has to be called several times per frame (for
+/// example, from a VCount interrupt handler). All the fields are optional, the
+/// default values are the same as classic double buffering.
 typedef struct t_mmgbasystem
 {
     /// Software mixing rate. May be 8, 10, 13, 16, 18, or 21 KHz (select value
@@ -328,8 +541,34 @@ typedef struct t_mmgbasystem
     /// space).
     mm_addr     soundbank;
 
+    /// Number of frames of audio that fit in the wave buffer. It can go from 2
+    /// to MM_WAVE_FRAMES_MAX. 0 selects the default value, 2.
+    mm_word     wave_frames;
+
+    /// Number of chunks each frame of audio is split into. It can be 1, 2 or 4.
+    /// 0 selects the default value, 1.
+    mm_word     frame_chunks;
+
+    /// Number of chunks mixed ahead of the chunk being played. 0 selects the
+    /// default value, ``frame_chunks * (wave_frames - 1)``. The maximum value
+    /// is ``frame_chunks * wave_frames - 1`` if frame_chunks is 1, and
+    /// ``frame_chunks * wave_frames - 2`` otherwise.
+    mm_word     mix_ahead;
+
+    /// Optional memory used to keep copies of frequently triggered samples
+    /// (percussion, UI sounds...), so that they don't have to be read from ROM
+    /// every time they are mixed. It can be placed in EWRAM or IWRAM, and it
+    /// must be aligned to 4 bytes. NULL disables the cache.
+    mm_addr     sample_cache;
+
+    /// Size of the sample cache in bytes.
+    mm_word     sample_cache_size;
+
 } mm_gba_system;
 
+/// Maximum number of frames of audio that the GBA wave buffer can hold.
+#define MM_WAVE_FRAMES_MAX  8
+
 /// DS setup information.
 ///
 /// More about mem_bank: Maxmod needs some memory to manage samples and modules
@@ -403,12 +642,15 @@ typedef struct t_mmstreamdata
     mm_hword            length_cut;
     mm_hword            length_words;
     mm_hword            position;
-    mm_hword            reserved2;
+    mm_hword            previous_timer;
     volatile mm_hword   *hw_timer;
     mm_addr             wave_memory;
     mm_addr             work_memory;
     mm_stream_func      callback;
     mm_word             remainder;
+    mm_stream_planar_func planar_callback;
+    mm_word             counter;
+    mm_byte             id;
 } mm_stream_data;
 
 typedef struct tmm_voice
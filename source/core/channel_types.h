@@ -186,7 +186,7 @@ typedef struct {
     mm_word     read; // Fixed point 20.12. See MP_SAMPFRAC
     mm_byte     vol;
     mm_byte     pan;
-    mm_byte     unused_0;
+    mm_byte     bus;  // mm_bus the channel is mixed into
     mm_byte     unused_1;
     mm_word     freq;
 } mm_mixer_channel;
@@ -21,9 +21,12 @@
 #if defined(__GBA__)
 #include "gba/main_gba.h"
 #include "gba/mixer.h"
+#include "gba/sample_cache.h"
 #elif defined(__NDS__)
+#include "ds/arm7/comms_ds7.h"
 #include "ds/arm7/main_ds7.h"
 #include "ds/arm7/mixer.h"
+#include "ds/common/comm_messages.h"
 #endif
 
 #define releaseLevel    200
@@ -36,13 +39,32 @@ typedef struct {
     mm_byte counter; // Taken from mm_sfx_counter
 } mm_sfx_channel_state;
 
-static mm_sfx_channel_state mm_sfx_channels[EFFECT_CHANNELS];
+static mm_sfx_channel_state mm_sfx_channels[EFFECT_CHANNELS_TOTAL];
 
 static mm_word mm_sfx_bitmask; // Channels in use
 
+#ifdef __NDS__
+// Effect channels of the ARM9 that have been freed, and the counter of the
+// handle that was using them. The ARM9 needs to know it to reuse them.
+static mm_word mm_sfx_arm9_freed;
+static mm_byte mm_sfx_arm9_freed_counter[EFFECT_CHANNELS_ARM9];
+#endif
+
 // Counter that increments every time a new effect is played
 static mm_byte mm_sfx_counter;
 
+// Gain applied by the mixer to every voice of a bus (0 to 256). It combines the
+// bus volume with the ducking gain, and it's only refreshed once per frame.
+mm_word mm_bus_gain[MM_BUS_COUNT] = { 256, 256 };
+
+static mm_word mm_bus_volume[MM_BUS_COUNT] = { 1024, 1024 }; // 0 to 1024
+
+// Music ducking while sound effects are playing. All values are 0 to 1024.
+static mm_word mm_duck_level = 1024;    // Music gain while effects play
+static mm_word mm_duck_attack;          // Gain decrease per frame
+static mm_word mm_duck_release;         // Gain increase per frame
+static mm_word mm_duck_gain = 1024;     // Current ducking gain
+
 // Test handle and return mixing channel index
 static int mme_get_mix_channel_index(mm_sfxhand handle)
 {
@@ -52,7 +74,7 @@ static int mme_get_mix_channel_index(mm_sfxhand handle)
     if (sfx_channel < 0)
         return -1;
 
-    if (sfx_channel >= EFFECT_CHANNELS)
+    if (sfx_channel >= EFFECT_CHANNELS_TOTAL)
         return -1;
 
     mm_sfx_channel_state *state = &mm_sfx_channels[sfx_channel];
@@ -64,9 +86,28 @@ static int mme_get_mix_channel_index(mm_sfxhand handle)
     return state->mix_channel - 1;
 }
 
+// Remember that an effect channel of the ARM9 has been freed
+static void mme_report_freed(int sfx_channel, mm_byte counter)
+{
+#ifdef __NDS__
+    if (sfx_channel < EFFECT_CHANNELS)
+        return;
+
+    sfx_channel -= EFFECT_CHANNELS;
+
+    mm_sfx_arm9_freed |= 1U << sfx_channel;
+    mm_sfx_arm9_freed_counter[sfx_channel] = counter;
+#else
+    (void)sfx_channel;
+    (void)counter;
+#endif
+}
+
 // Clear sfx channel entry and bitmask
 static void mme_clear_sfx_channel(int sfx_channel)
 {
+    mme_report_freed(sfx_channel, mm_sfx_channels[sfx_channel].counter);
+
     // Clear channel effect
 
     mm_sfx_channels[sfx_channel].counter = 0;
@@ -83,8 +124,11 @@ static void mme_clear_sfx_channel(int sfx_channel)
 // sound engine.
 void mmResetEffects(void)
 {
-    for (int i = 0; i < EFFECT_CHANNELS; i++)
+    for (int i = 0; i < EFFECT_CHANNELS_TOTAL; i++)
     {
+        if (mm_sfx_bitmask & (1U << i))
+            mme_report_freed(i, mm_sfx_channels[i].counter);
+
         mm_sfx_channels[i].counter = 0;
         mm_sfx_channels[i].mix_channel = 0;
     }
@@ -92,13 +136,24 @@ void mmResetEffects(void)
     mm_sfx_bitmask = 0;
 }
 
+// Make the handles that point to a mixer channel point to a different one. The
+// mixer uses this when it moves a sound to another channel.
+void mmEffectMoveChannel(int from, int to)
+{
+    for (int i = 0; i < EFFECT_CHANNELS_TOTAL; i++)
+    {
+        if (mm_sfx_channels[i].mix_channel == from + 1)
+            mm_sfx_channels[i].mix_channel = to + 1;
+    }
+}
+
 // Return index to free effect channel. If no channels are free, it returns -1.
 static int mme_get_free_sfx_channel(void)
 {
     // Look for the first clear bit
     for (int i = 0; i < EFFECT_CHANNELS; i++)
     {
-        if (mm_sfx_bitmask & (1 << i))
+        if (mm_sfx_bitmask & (1U << i))
             continue;
 
         return i;
@@ -122,54 +177,10 @@ mm_sfxhand mmEffect(mm_word sample_ID)
     return mmEffectEx(&effect);
 }
 
-// Play sound effect with specified parameters
-mm_sfxhand mmEffectEx(mm_sound_effect *sound)
+// Register a sound effect in an effect channel and start it in a mixer channel
+static mm_sfxhand mme_start_effect(mm_sound_effect *sound, int sfx_channel,
+                                   mm_byte sfx_count, int mix_channel)
 {
-    if (sound->id >= mmGetSampleCount())
-        return MM_SFXHAND_INVALID;
-
-    int sfx_channel = -1;
-    int mix_channel = NO_CHANNEL_AVAILABLE;
-    mm_byte sfx_count;
-
-    // Reuse or create new SFX handle
-    // ------------------------------
-
-    bool reused_handle = false;
-
-    if (sound->handle != 0)
-    {
-        // If there is a provided handle, check if it's valid
-        mix_channel = mme_get_mix_channel_index(sound->handle);
-        if (mix_channel >= 0)
-        {
-            // It's valid, reuse the old mixer channel, as well as the sfx
-            // channel and count.
-            sfx_channel = (sound->handle & 0xFF) - 1;
-            sfx_count = sound->handle >> 8;
-
-            reused_handle = true;
-        }
-    }
-
-    if (!reused_handle)
-    {
-        // No reused handle, generate a new one
-
-        sfx_channel = mme_get_free_sfx_channel();
-        if (sfx_channel < 0)
-            return MM_SFXHAND_INVALID;
-
-        // Allocate new mixer channel
-        mix_channel = mmAllocChannel();
-        if (mix_channel == NO_CHANNEL_AVAILABLE)
-            return MM_SFXHAND_INVALID;
-
-        sfx_count = mm_sfx_counter;
-
-        mm_sfx_counter++;
-    }
-
     // Generate new handle and register SFX information
     // ------------------------------------------------
 
@@ -209,7 +220,7 @@ mm_sfxhand mmEffectEx(mm_sound_effect *sound)
     mm_byte *sample_addr = ((mm_byte *)mp_solution) + sample_offset;
     mm_mas_gba_sample *sample = (mm_mas_gba_sample *)(sample_addr + sizeof(mm_mas_prefix));
 
-    mix_ch->src = (uintptr_t)(&(sample->data[0]));
+    mix_ch->src = mmSampleCacheGet(sample);
 
     // set pitch to original * pitch
     mix_ch->freq = (sound->rate * sample->default_frequency) >> (10 - 2);
@@ -219,6 +230,7 @@ mm_sfxhand mmEffectEx(mm_sound_effect *sound)
 
     mix_ch->vol = (sound->volume * mm_sfx_mastervolume) >> 10;
     mix_ch->pan = sound->panning;
+    mix_ch->bus = MM_BUS_EFFECTS;
 
 #elif defined(__NDS__)
 
@@ -256,6 +268,9 @@ mm_sfxhand mmEffectEx(mm_sound_effect *sound)
     mix_ch->key_on = 0;
     mix_ch->samp = source;
 
+    mm_mix_bus_mask |= 1U << mix_channel;
+    mmMixerSetRamp(mix_channel, MM_RAMP_DEFAULT);
+
     mm_mas_ds_sample *sample = (mm_mas_ds_sample *)source;
 
     // Set pitch to original * pitch
@@ -276,6 +291,135 @@ mm_sfxhand mmEffectEx(mm_sound_effect *sound)
     return handle;
 }
 
+// Play sound effect with specified parameters
+mm_sfxhand mmEffectEx(mm_sound_effect *sound)
+{
+    if (sound->id >= mmGetSampleCount())
+        return MM_SFXHAND_INVALID;
+
+    int sfx_channel = -1;
+    int mix_channel = NO_CHANNEL_AVAILABLE;
+    mm_byte sfx_count;
+
+    // Reuse or create new SFX handle
+    // ------------------------------
+
+    bool reused_handle = false;
+
+    if (sound->handle != 0)
+    {
+        // If there is a provided handle, check if it's valid
+        mix_channel = mme_get_mix_channel_index(sound->handle);
+        if (mix_channel >= 0)
+        {
+            // It's valid, reuse the old mixer channel, as well as the sfx
+            // channel and count.
+            sfx_channel = (sound->handle & 0xFF) - 1;
+            sfx_count = sound->handle >> 8;
+
+            reused_handle = true;
+        }
+    }
+
+    if (!reused_handle)
+    {
+        // No reused handle, generate a new one
+
+        sfx_channel = mme_get_free_sfx_channel();
+        if (sfx_channel < 0)
+            return MM_SFXHAND_INVALID;
+
+        // Allocate new mixer channel
+        mix_channel = mmAllocChannel();
+        if (mix_channel == NO_CHANNEL_AVAILABLE)
+            return MM_SFXHAND_INVALID;
+
+        sfx_count = mm_sfx_counter;
+
+        mm_sfx_counter++;
+    }
+
+    return mme_start_effect(sound, sfx_channel, sfx_count, mix_channel);
+}
+
+#ifdef __NDS__
+// Play a sound effect with a handle allocated by the ARM9. The ARM9 doesn't wait
+// for an answer. If the effect can't be played, the effect channel is reported
+// as freed by mmEffectSendFreed(). If "sound->handle" is a valid handle of the
+// same effect channel, its mixer channel is reused.
+void mmEffectExHandle(mm_sound_effect *sound, mm_sfxhand handle)
+{
+    int sfx_channel = (handle & 0xFF) - 1;
+    mm_byte sfx_count = handle >> 8;
+
+    if ((sfx_channel < EFFECT_CHANNELS) || (sfx_channel >= EFFECT_CHANNELS_TOTAL))
+        return;
+
+    int mix_channel = mme_get_mix_channel_index(sound->handle);
+
+    if ((mix_channel < 0) || ((sound->handle & 0xFF) - 1 != sfx_channel))
+    {
+        // The ARM9 only uses a channel again after it has been told that it's
+        // free, so it should never be in use here. If it is, stop the old
+        // effect quietly, the ARM9 doesn't expect a report for it.
+        int old_channel = mm_sfx_channels[sfx_channel].mix_channel - 1;
+        if (old_channel >= 0)
+        {
+            mm_achannels[old_channel].type = ACHN_BACKGROUND;
+            mm_achannels[old_channel].fvol = 0;
+            mmMixerStopChannel(old_channel);
+        }
+
+        mm_sfx_channels[sfx_channel].counter = 0;
+        mm_sfx_channels[sfx_channel].mix_channel = 0;
+        mm_sfx_bitmask &= ~(1U << sfx_channel);
+
+        mix_channel = NO_CHANNEL_AVAILABLE;
+
+        if (sound->id < mmGetSampleCount())
+            mix_channel = mmAllocChannel();
+
+        if (mix_channel == NO_CHANNEL_AVAILABLE)
+        {
+            mme_report_freed(sfx_channel, sfx_count);
+            return;
+        }
+    }
+
+    mme_start_effect(sound, sfx_channel, sfx_count, mix_channel);
+}
+
+// Get the handle that owns each effect channel, or 0 if it's free
+void mmEffectGetHandles(mm_sfxhand *handles)
+{
+    for (int i = 0; i < EFFECT_CHANNELS_TOTAL; i++)
+    {
+        if (mm_sfx_bitmask & (1U << i))
+            handles[i] = (mm_sfx_channels[i].counter << 8) | (i + 1);
+        else
+            handles[i] = 0;
+    }
+}
+
+// Tell the ARM9 which of its effect channels have been freed
+void mmEffectSendFreed(void)
+{
+    while (mm_sfx_arm9_freed != 0)
+    {
+        int i = __builtin_ctz(mm_sfx_arm9_freed);
+
+        mm_sfxhand handle = (mm_sfx_arm9_freed_counter[i] << 8) |
+                            (EFFECT_CHANNELS + i + 1);
+
+        // If the FIFO is full, try again in the next frame
+        if (!mmARM9msg(MSG_ARM7_SFX_FREED, handle))
+            break;
+
+        mm_sfx_arm9_freed &= ~(1U << i);
+    }
+}
+#endif
+
 // Set master volume scale, 0->1024
 void mmSetEffectsVolume(mm_word volume)
 {
@@ -285,6 +429,70 @@ void mmSetEffectsVolume(mm_word volume)
     mm_sfx_mastervolume = volume;
 }
 
+static void mmUpdateBusGain(void)
+{
+    mm_bus_gain[MM_BUS_MUSIC] = (mm_bus_volume[MM_BUS_MUSIC] * mm_duck_gain) >> 12;
+    mm_bus_gain[MM_BUS_EFFECTS] = mm_bus_volume[MM_BUS_EFFECTS] >> 2;
+}
+
+// Set the volume of a mix bus, 0->1024
+void mmSetBusVolume(mm_bus bus, mm_word volume)
+{
+    if (bus >= MM_BUS_COUNT)
+        return;
+
+    if (volume > 1024)
+        volume = 1024;
+
+    mm_bus_volume[bus] = volume;
+
+    mmUpdateBusGain();
+}
+
+// Set the music gain used while effects play, and how fast it's reached
+void mmSetMusicDucking(mm_word level, mm_word attack, mm_word release)
+{
+    if (level > 1024)
+        level = 1024;
+
+    mm_duck_level = level;
+    mm_duck_attack = attack;
+    mm_duck_release = release;
+}
+
+// Move the ducking gain towards its target. A rate of zero is instant.
+static void mmUpdateDucking(bool effects_active)
+{
+    mm_word gain = mm_duck_gain;
+
+    if (effects_active && (gain > mm_duck_level))
+    {
+        if ((mm_duck_attack == 0) || (gain - mm_duck_level <= mm_duck_attack))
+            gain = mm_duck_level;
+        else
+            gain -= mm_duck_attack;
+    }
+    else if (!effects_active && (gain < 1024))
+    {
+        if ((mm_duck_release == 0) || (1024 - gain <= mm_duck_release))
+            gain = 1024;
+        else
+            gain += mm_duck_release;
+    }
+    else if (effects_active && (gain < mm_duck_level))
+    {
+        // The level has been raised while ducking
+        gain = mm_duck_level;
+    }
+
+    if (gain == mm_duck_gain)
+        return;
+
+    mm_duck_gain = gain;
+
+    mmUpdateBusGain();
+}
+
 // Set effect panning (0..255)
 void mmEffectPanning(mm_sfxhand handle, mm_byte panning)
 {
@@ -343,6 +551,18 @@ void mmEffectScaleRate(mm_sfxhand handle, mm_word factor)
     mmMixerMulFreq(mix_channel, factor);
 }
 
+#ifdef __NDS__
+// Set effect volume and panning ramp rate
+void mmEffectRamp(mm_sfxhand handle, mm_word rate)
+{
+    int mix_channel = mme_get_mix_channel_index(handle);
+    if (mix_channel < 0)
+        return;
+
+    mmMixerSetRamp(mix_channel, rate);
+}
+#endif
+
 // Stop sound effect
 mm_word mmEffectCancel(mm_sfxhand handle)
 {
@@ -422,16 +642,19 @@ void mmUpdateEffects(void)
     // Keep track of the channels that are still active after the update
     mm_word new_bitmask = 0;
 
-    for (int i = 0; i < EFFECT_CHANNELS; i++)
+    for (int i = 0; i < EFFECT_CHANNELS_TOTAL; i++)
     {
-        if ((mm_sfx_bitmask & (1 << i)) == 0)
+        if ((mm_sfx_bitmask & (1U << i)) == 0)
             continue;
 
         // Get channel index
 
         int mix_channel = mm_sfx_channels[i].mix_channel - 1;
         if (mix_channel < 0)
+        {
+            mme_report_freed(i, mm_sfx_channels[i].counter);
             continue;
+        }
 
         // Test if channel is still active
 
@@ -442,7 +665,7 @@ void mmUpdateEffects(void)
         if (mix_ch->samp != 0)
 #endif
         {
-            new_bitmask |= (1 << i);
+            new_bitmask |= (1U << i);
             continue;
         }
 
@@ -453,10 +676,33 @@ void mmUpdateEffects(void)
         act_ch->type = 0;
         act_ch->flags = 0;
 
+        mme_report_freed(i, mm_sfx_channels[i].counter);
+
         mm_sfx_channels[i].counter = 0;
         mm_sfx_channels[i].mix_channel = 0;
     }
 
     // Update the mask of active channels
     mm_sfx_bitmask = new_bitmask;
+
+    // Released effects keep playing without a handle, so look at the mixer
+    // channels to see if any effect can still be heard.
+    bool effects_active = false;
+
+    mm_mixer_channel *mix_ch = &mm_mix_channels[0];
+
+    for (mm_word i = 0; i < mm_num_ach; i++, mix_ch++)
+    {
+#if defined(__GBA__)
+        if ((mix_ch->bus == MM_BUS_EFFECTS) && ((mix_ch->src & MIXCH_GBA_SRC_STOPPED) == 0))
+#elif defined(__NDS__)
+        if ((mm_mix_bus_mask & (1U << i)) && (mix_ch->samp != 0))
+#endif
+        {
+            effects_active = true;
+            break;
+        }
+    }
+
+    mmUpdateDucking(effects_active);
 }
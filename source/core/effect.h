@@ -11,7 +11,26 @@
 // This must be at most 254 to prevent overflows in SFX handles
 #define EFFECT_CHANNELS 16
 
+// On DS, the ARM9 can allocate handles by itself (see mmEnableAsyncEffects()).
+// They use their own effect channels, after the ones used by the ARM7.
+#ifdef __NDS__
+#define EFFECT_CHANNELS_ARM9    16
+#else
+#define EFFECT_CHANNELS_ARM9    0
+#endif
+
+#define EFFECT_CHANNELS_TOTAL   (EFFECT_CHANNELS + EFFECT_CHANNELS_ARM9)
+
+// Gain of each mix bus (0 to 256), read by the mixers
+extern mm_word mm_bus_gain[MM_BUS_COUNT];
+
 void mmResetEffects(void);
+void mmEffectMoveChannel(int from, int to);
 void mmUpdateEffects(void);
+#ifdef __NDS__
+void mmEffectExHandle(mm_sound_effect *sound, mm_sfxhand handle);
+void mmEffectSendFreed(void);
+void mmEffectGetHandles(mm_sfxhand *handles);
+#endif
 
 #endif // MM_CORE_EFFECT_H__
@@ -18,6 +18,7 @@
 #if defined(__GBA__)
 #include "gba/main_gba.h"
 #include "gba/mixer.h"
+#include "gba/sample_cache.h"
 #elif defined(__NDS__)
 #include "ds/arm7/main_ds7.h"
 #include "ds/arm7/mixer.h"
@@ -3288,13 +3289,16 @@ static mm_mixer_channel *mpp_Update_ACHN_notest_update_mix(mpl_layer_information
 #ifdef __GBA__
         mm_mas_gba_sample *gba_sample = (mm_mas_gba_sample *)&(sample->data[0]);
 
-        mix_ch->src = (uintptr_t)&(gba_sample->data[0]);
+        mix_ch->src = mmSampleCacheGet(gba_sample);
+        mix_ch->bus = MM_BUS_MUSIC;
 #else
         mm_mas_ds_sample *ds_sample = (mm_mas_ds_sample *)&(sample->data[0]);
 
         mix_ch->samp = ((mm_word)ds_sample) - 0x2000000;
         mix_ch->tpan = 0;
         mix_ch->key_on = 1;
+
+        mm_mix_bus_mask &= ~(1U << channel);
 #endif
     }
     else
@@ -3307,7 +3311,8 @@ static mm_mixer_channel *mpp_Update_ACHN_notest_update_mix(mpl_layer_information
         mm_byte *sample_addr = ((mm_byte *)mp_solution) + sample_offset;
         mm_mas_gba_sample *gba_sample = (mm_mas_gba_sample *)(sample_addr + sizeof(mm_mas_prefix));
 
-        mix_ch->src = (uintptr_t)(&(gba_sample->data[0]));
+        mix_ch->src = mmSampleCacheGet(gba_sample);
+        mix_ch->bus = MM_BUS_MUSIC;
 #else
         mm_word source = mmSampleBank[sample->msl_id];
         source &= 0xFFFFFF; // Mask out counter value
@@ -3321,6 +3326,8 @@ static mm_mixer_channel *mpp_Update_ACHN_notest_update_mix(mpl_layer_information
         mix_ch->samp = source;
         mix_ch->tpan = 0;
         mix_ch->key_on = 1;
+
+        mm_mix_bus_mask &= ~(1U << channel);
 #endif
     }
 
@@ -5,6 +5,7 @@
 // Copyright (c) 2025, Antonio Niño Díaz (antonio_nd@outlook.com)
 
 #include <stdint.h>
+#include <string.h>
 
 #include <nds.h>
 
@@ -16,8 +17,13 @@
 #include "core/mas.h"
 #include "core/player_types.h"
 #include "ds/arm7/comms_ds7.h"
+#include "ds/arm7/load.h"
 #include "ds/arm7/main_ds7.h"
+#include "ds/arm7/mixer.h"
 #include "ds/common/comm_messages.h"
+#include "ds/common/events.h"
+#include "ds/common/ring.h"
+#include "ds/common/status.h"
 #include "ds/common/stream.h"
 
 /***********************************************************************
@@ -41,8 +47,6 @@
 #define FIFO_MAXMOD 7
 #define FIFO_SIZE 256
 
-#define MAX_DATAMSG_SIZE 32
-
 #define NUM_MESSAGE_KINDS_BITS 6
 #define NUM_MESSAGE_KINDS (1 << NUM_MESSAGE_KINDS_BITS)
 
@@ -58,8 +62,40 @@ volatile mm_byte mmFifoPositionWQ;
 
 static mm_word mmFifoChannel;
 
+// Ring of commands set up by the ARM9 with mmEnableCommandRing(). Each entry
+// has the same format as a datamsg.
+static mm_ring *mmCommandRing;
+
+// Command read from the ring that is being processed. It isn't shared with the
+// FIFO interrupt handler, so it can be read without a critical section.
+static mm_word mmRingRecord[MAX_DATAMSG_SIZE / sizeof(mm_word)];
+static mm_byte *mmRingRecordPos;
+static mm_byte *mmRingRecordEnd;
+
+// Status block set up by the ARM9 with mmGetARM7Status(). Once it has been set
+// up, MSG_ARM7_UPDATE isn't sent anymore.
+static mm_status_block *mmStatusBlock;
+
+// Ring of song events set up by the ARM9 with mmPollEvents(). Once it has been
+// set up, MSG_ARM7_SONG_EVENT isn't sent anymore.
+static mm_ring *mmEventRing;
+
+// Commands sent with a target time (see mmBeginSchedule()). They are kept in
+// the order in which they have arrived.
+#define SCHEDULED_COMMANDS  32
+
+typedef struct {
+    mm_word time;
+    mm_byte length;
+    mm_byte data[MAX_SCHEDULED_COMMAND_SIZE];
+} mm_scheduled_command;
+
+static mm_scheduled_command mmScheduled[SCHEDULED_COMMANDS];
+static mm_word mmScheduledCount;
+
 static void mmReceiveDatamsg(int, void*);
 static void ProcessNextMessage(void);
+static void ProcessCommandsInMemory(mm_byte *data, mm_word size);
 
 // ARM7 Communication Setup
 void mmSetupComms(mm_word channel)
@@ -120,9 +156,54 @@ mm_bool mmARM9msg(mm_byte cmd, mm_word value)
     return fifoSendValue32(mmFifoChannel, (cmd << 20) | value);
 }
 
+static void mmFillLayerStatus(mm_layer_status *status, mpl_layer_information *layer)
+{
+    status->tick = layer->tick;
+    status->row = layer->row;
+    status->position = layer->position;
+    status->speed = layer->speed;
+    status->tempo = layer->bpm;
+    status->playing = layer->isplaying;
+}
+
+// Write the status block read by the ARM9
+static void mmPublishStatus(void)
+{
+    mm_status_block *block = mmStatusBlock;
+
+    // The ARM9 ignores the block while the counter is odd
+    block->sequence++;
+    mmStatusBarrier();
+
+    mmFillLayerStatus(&block->status.main, &mmLayerMain);
+    mmFillLayerStatus(&block->status.jingle, &mmLayerSub);
+
+    mm_word active = 0;
+    for (int i = 0; i < NUM_CHANNELS; i++)
+    {
+        if (mm_mix_channels[i].samp != 0)
+            active |= 1U << i;
+    }
+    block->status.active_channels = active;
+
+    block->status.update_count++;
+    block->status.clock = mm_mix_clock;
+
+    mmEffectGetHandles(block->effects);
+
+    mmStatusBarrier();
+    block->sequence++;
+}
+
 // Give ARM9 some data
 void mmSendUpdateToARM9(void)
 {
+    if (mmStatusBlock != NULL)
+    {
+        mmPublishStatus();
+        return;
+    }
+
     uint32_t value = 0;
 
     // Send pattern and row, but not the tick. The tick changes too fast,
@@ -139,6 +220,26 @@ void mmSendUpdateToARM9(void)
     mmARM9msg(MSG_ARM7_UPDATE, value);
 }
 
+// Send a song event to the ARM9
+mm_bool mmSendSongEvent(mm_word msg, mm_word param)
+{
+    if (mmEventRing == NULL)
+        return mmARM9msg(MSG_ARM7_SONG_EVENT, msg | (param << 8));
+
+    // Ticks are only processed at the start of a mixer update, so the time of
+    // the event is the time of the update.
+    mpl_layer_information *layer = mpp_layerp;
+
+    mm_word record[EVENT_RECORD_WORDS];
+
+    record[0] = msg | (param << 8) | (mpp_clayer << 16);
+    record[1] = layer->tick | (layer->row << 8) | (layer->position << 16);
+    record[2] = mm_mix_clock;
+
+    // If the ARM9 doesn't empty the ring often enough, new events are lost
+    return mmRingPush(mmEventRing, record, EVENT_RECORD_WORDS);
+}
+
 static void mmSendHandleToARM9(mm_sfxhand handle)
 {
     // We use the address handler to send SFX handles because the Value32
@@ -162,6 +263,55 @@ void mmProcessComms(void)
 
         ProcessNextMessage();
     }
+
+    if (mmCommandRing == NULL)
+        return;
+
+    while (mmRingUsed(mmCommandRing) > 0)
+    {
+        mm_word size = mmRingPeek(mmCommandRing) & 0xFF;
+        mm_word num_words = (size + 1 + 3) / sizeof(mm_word);
+
+        // Don't read bad data!!!
+        if (size > (MAX_DATAMSG_SIZE - 1))
+            num_words = 1;
+
+        if (!mmRingPop(mmCommandRing, mmRingRecord, num_words))
+            break;
+
+        if (size > (MAX_DATAMSG_SIZE - 1))
+            continue;
+
+        ProcessCommandsInMemory(((mm_byte *)mmRingRecord) + 1, size);
+    }
+}
+
+// Run the scheduled commands whose time has been reached by the mixer
+void mmProcessScheduledCommands(void)
+{
+    mm_word i = 0;
+
+    while (i < mmScheduledCount)
+    {
+        mm_scheduled_command *command = &mmScheduled[i];
+
+        if ((int32_t)(command->time - mm_mix_clock) > 0)
+        {
+            i++;
+            continue;
+        }
+
+        // Copy the command so that the array can be modified by the command
+        mm_byte data[MAX_SCHEDULED_COMMAND_SIZE];
+        mm_word length = command->length;
+
+        memcpy(data, command->data, length);
+
+        mmScheduledCount--;
+        memmove(command, command + 1, (mmScheduledCount - i) * sizeof(mm_scheduled_command));
+
+        ProcessCommandsInMemory(data, length);
+    }
 }
 
 // Read X bytes from the FIFO
@@ -169,6 +319,14 @@ static mm_word ReadNFifoBytes(int n_bytes)
 {
     mm_word value = 0;
 
+    if (mmRingRecordPos != NULL)
+    {
+        for (int i = 0; i < n_bytes; i++)
+            value |= *mmRingRecordPos++ << (8 * i);
+
+        return value;
+    }
+
     int oldIME = enterCriticalSection();
 
     for (int i = 0; i < n_bytes; i++)
@@ -182,11 +340,50 @@ static mm_word ReadNFifoBytes(int n_bytes)
     return value;
 }
 
+// Process commands stored in memory instead of in the FIFO
+static void ProcessCommandsInMemory(mm_byte *data, mm_word size)
+{
+    mm_byte *old_pos = mmRingRecordPos;
+    mm_byte *old_end = mmRingRecordEnd;
+
+    mmRingRecordPos = data;
+    mmRingRecordEnd = data + size;
+
+    while (mmRingRecordPos < mmRingRecordEnd)
+        ProcessNextMessage();
+
+    mmRingRecordPos = old_pos;
+    mmRingRecordEnd = old_end;
+}
+
+// Store a command to run it later. If there is no space left it runs right away.
+static void ScheduleCommand(mm_word time, mm_word length)
+{
+    mm_byte data[MAX_SCHEDULED_COMMAND_SIZE];
+
+    for (mm_word i = 0; i < length; i++)
+        data[i] = ReadNFifoBytes(1);
+
+    if (mmScheduledCount == SCHEDULED_COMMANDS)
+    {
+        ProcessCommandsInMemory(data, length);
+        return;
+    }
+
+    mm_scheduled_command *command = &mmScheduled[mmScheduledCount++];
+
+    command->time = time;
+    command->length = length;
+    memcpy(command->data, data, length);
+}
+
 // Do the actual processing with a switch
 static void ProcessNextMessage(void)
 {
     enum mm_message_ids msg_id = (enum mm_message_ids)ReadNFifoBytes(1);
 
+    mmLoadCountCommand();
+
     // If Maxmod hasn't been initialized the only command allowed is MSG_BANK to
     // initialize Maxmod.
     if (!mmIsInitialized())
@@ -296,19 +493,81 @@ static void ProcessNextMessage(void)
             mm_word clks = ReadNFifoBytes(2);
             mm_word len = ReadNFifoBytes(2);
             mm_stream_formats format = ReadNFifoBytes(1);
-            mmStreamBegin(wavebuffer, clks, len, format);
+            mm_word id = ReadNFifoBytes(1);
+            mmStreamBegin(id, wavebuffer, clks, len, format);
             mmARM9msg(MSG_ARM7_STREAM_READY, 0);
             break;
         }
         case MSG_CLOSESTREAM:
         {
-            mmStreamEnd();
+            mm_word id = ReadNFifoBytes(1);
+            mmStreamEnd(id);
             mmARM9msg(MSG_ARM7_STREAM_READY, 0);
             break;
         }
         case MSG_SELECTMODE:
             mmSelectMode((mm_mode_enum)ReadNFifoBytes(1));
             break;
+        case MSG_SELECTMODELIVE:
+            mmSelectModeLive((mm_mode_enum)ReadNFifoBytes(1));
+            break;
+        case MSG_LOADBLOCK:
+            mmLoadSetBlock((mm_arm7_load *)ReadNFifoBytes(4));
+            break;
+        case MSG_COMMANDRING:
+            mmCommandRing = (mm_ring *)ReadNFifoBytes(4);
+            break;
+        case MSG_STATUSBLOCK:
+            mmStatusBlock = (mm_status_block *)ReadNFifoBytes(4);
+            break;
+        case MSG_EVENTRING:
+            mmEventRing = (mm_ring *)ReadNFifoBytes(4);
+            break;
+        case MSG_SCHEDULE:
+        {
+            mm_word time = ReadNFifoBytes(4);
+            mm_word length = ReadNFifoBytes(1);
+
+            // Don't read bad data!!! Skip the command instead.
+            if (length > MAX_SCHEDULED_COMMAND_SIZE)
+            {
+                for (mm_word i = 0; i < length; i++)
+                    ReadNFifoBytes(1);
+                break;
+            }
+
+            ScheduleCommand(time, length);
+            break;
+        }
+        case MSG_MODULERAMP:
+        {
+            mm_word rate = ReadNFifoBytes(2);
+            mm_bool instant_attack = ReadNFifoBytes(1);
+            mmSetModuleRamp(rate, instant_attack);
+            break;
+        }
+        case MSG_MODEBCONFIG:
+        {
+            mm_mode_b_config config;
+            config.slice_length = ReadNFifoBytes(2);
+            config.slice_count = ReadNFifoBytes(2);
+            config.output = (mm_addr)ReadNFifoBytes(4);
+            mmSetModeBConfig(&config);
+            break;
+        }
+        case MSG_MODECVOICES:
+        {
+            mm_word hardware = ReadNFifoBytes(1);
+            mm_word software = ReadNFifoBytes(1);
+            mmSetModeCVoices(hardware, software);
+            break;
+        }
+        case MSG_MODECBUDGET:
+            mmSetModeCBudget(ReadNFifoBytes(4));
+            break;
+        case MSG_INTERPOLATION:
+            mmSetInterpolation((mm_interpolation)ReadNFifoBytes(1));
+            break;
         case MSG_EFFECT:
         {
             mm_sfxhand handle = mmEffect(ReadNFifoBytes(2));
@@ -329,6 +588,13 @@ static void ProcessNextMessage(void)
             mmEffectPanning(handle, panning);
             break;
         }
+        case MSG_EFFECTRAMP:
+        {
+            mm_sfxhand handle = (mm_sfxhand)ReadNFifoBytes(2);
+            mm_hword rate = ReadNFifoBytes(2);
+            mmEffectRamp(handle, rate);
+            break;
+        }
         case MSG_EFFECTRATE:
         {
             mm_sfxhand handle = (mm_sfxhand)ReadNFifoBytes(2);
@@ -369,6 +635,19 @@ static void ProcessNextMessage(void)
             mmSendHandleToARM9(handle);
             break;
         }
+        case MSG_EFFECTEXHANDLE:
+        {
+            mm_sound_effect sfx;
+            sfx.sample = (mm_ds_sample *)ReadNFifoBytes(4);
+            sfx.rate = ReadNFifoBytes(2);
+            sfx.handle = (mm_sfxhand)ReadNFifoBytes(2);
+            mm_sfxhand handle = (mm_sfxhand)ReadNFifoBytes(2);
+            sfx.volume = ReadNFifoBytes(1);
+            sfx.panning = ReadNFifoBytes(1);
+
+            mmEffectExHandle(&sfx, handle);
+            break;
+        }
         case MSG_REVERBENABLE:
             mmReverbEnable();
             break;
@@ -408,7 +687,23 @@ static void ProcessNextMessage(void)
         case MSG_STREAMVOL:
         {
             mm_byte volume = ReadNFifoBytes(1);
-            mmStreamVolume(volume);
+            mm_word id = ReadNFifoBytes(1);
+            mmStreamVolumeEx(id, volume);
+            break;
+        }
+        case MSG_BUSVOL:
+        {
+            mm_word volume = ReadNFifoBytes(2);
+            mm_bus bus = ReadNFifoBytes(1);
+            mmSetBusVolume(bus, volume);
+            break;
+        }
+        case MSG_DUCKING:
+        {
+            mm_word level = ReadNFifoBytes(2);
+            mm_word attack = ReadNFifoBytes(2);
+            mm_word release = ReadNFifoBytes(2);
+            mmSetMusicDucking(level, attack, release);
             break;
         }
         default:
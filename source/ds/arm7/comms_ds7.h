@@ -12,8 +12,10 @@
 #include "ds/common/comm_messages.h"
 
 mm_bool mmARM9msg(mm_byte cmd, mm_word value);
+mm_bool mmSendSongEvent(mm_word msg, mm_word param);
 void mmSendUpdateToARM9(void);
 void mmProcessComms(void);
+void mmProcessScheduledCommands(void);
 void mmSetupComms(mm_word);
 
 #endif // MM_DS_ARM7_COMMS7_H__
@@ -0,0 +1,162 @@
+// SPDX-License-Identifier: ISC
+//
+// Copyright (c) 2026, Antonio Niño Díaz (antonio_nd@outlook.com)
+
+#include <stddef.h>
+#include <string.h>
+
+#include <nds.h>
+
+#include <maxmod7.h>
+
+#include "ds/arm7/load.h"
+#include "ds/arm7/mixer.h"
+
+// The time is measured with the mixer timer, so nothing else is needed. It
+// counts from the reload value up to 0xFFFF once per update, with a resolution
+// of 256 or 1024 cycles depending on the mode. Parts that are shorter than that
+// still get a good average because they don't always start at the same point
+// between two timer ticks.
+
+// The averages are kept with this many extra bits of precision. They move
+// 1 / (1 << LOAD_AVERAGE_SHIFT) of the way to the new value every update.
+#define LOAD_AVERAGE_SHIFT  4
+
+// Number of updates of each window used to find the peak values
+#define LOAD_PEAK_WINDOW    64
+
+// Measurements are only done after mmGetARM7Load() has been called
+bool mm_load_enabled;
+
+// Ticks of the mixer timer spent in each part during the current update
+static mm_word mm_load_ticks[MM_LOAD_COUNT];
+
+static mm_word mm_load_average[MM_LOAD_COUNT];
+static mm_hword mm_load_peak[MM_LOAD_COUNT];        // Peak of the current window
+static mm_hword mm_load_last_peak[MM_LOAD_COUNT];   // Peak of the last window
+static mm_word mm_load_window_count;
+
+// Number of commands handled during the current update
+static mm_hword mm_load_commands;
+static mm_hword mm_load_commands_peak;
+static mm_hword mm_load_commands_last_peak;
+
+// Factor that converts timer ticks into hundredths of a percent (16.16)
+static mm_word mm_load_period;
+static mm_word mm_load_scale;
+
+static mm_arm7_load mm_load_stats;
+
+// Copy of the statistics in main RAM, read by the ARM9
+static volatile mm_arm7_load *mm_load_block;
+
+// Add the time elapsed since "start" to a part
+void mmLoadAdd(mm_load_part part, mm_word start)
+{
+    if (!mm_load_enabled)
+        return;
+
+    mm_word now = mmLoadTimestamp();
+    mm_word elapsed = now - start;
+
+    // The timer has been reloaded since the start
+    if (now < start)
+        elapsed += mm_mix_update_ticks;
+
+    mm_load_ticks[part] += elapsed;
+}
+
+// Count one command received from the ARM9
+void mmLoadCountCommand(void)
+{
+    if (!mm_load_enabled)
+        return;
+
+    mm_load_commands++;
+}
+
+// Update the statistics at the end of the timer interrupt
+void mmLoadFrameEnd(void)
+{
+    if (!mm_load_enabled)
+        return;
+
+    if (mm_load_period != mm_mix_update_ticks)
+    {
+        mm_load_period = mm_mix_update_ticks;
+        mm_load_scale = (10000 << 16) / mm_load_period;
+    }
+
+    for (int i = 0; i < MM_LOAD_COUNT; i++)
+    {
+        mm_word load = (mm_load_ticks[i] * mm_load_scale) >> 16;
+        mm_load_ticks[i] = 0;
+
+        mm_load_average[i] += load - (mm_load_average[i] >> LOAD_AVERAGE_SHIFT);
+
+        if (load > mm_load_peak[i])
+            mm_load_peak[i] = load;
+
+        mm_hword peak = mm_load_peak[i];
+        if (peak < mm_load_last_peak[i])
+            peak = mm_load_last_peak[i];
+
+        mm_load_stats.part[i].average = mm_load_average[i] >> LOAD_AVERAGE_SHIFT;
+        mm_load_stats.part[i].peak = peak;
+    }
+
+    mm_load_stats.commands += mm_load_commands;
+
+    if (mm_load_commands > mm_load_commands_peak)
+        mm_load_commands_peak = mm_load_commands;
+
+    mm_load_commands = 0;
+
+    if (mm_load_commands_peak > mm_load_commands_last_peak)
+        mm_load_stats.commands_peak = mm_load_commands_peak;
+    else
+        mm_load_stats.commands_peak = mm_load_commands_last_peak;
+
+    mm_load_window_count++;
+    if (mm_load_window_count == LOAD_PEAK_WINDOW)
+    {
+        mm_load_window_count = 0;
+
+        for (int i = 0; i < MM_LOAD_COUNT; i++)
+        {
+            mm_load_last_peak[i] = mm_load_peak[i];
+            mm_load_peak[i] = 0;
+        }
+
+        mm_load_commands_last_peak = mm_load_commands_peak;
+        mm_load_commands_peak = 0;
+    }
+
+    if (mm_load_block != NULL)
+    {
+        for (int i = 0; i < MM_LOAD_COUNT; i++)
+            mm_load_block->part[i] = mm_load_stats.part[i];
+
+        mm_load_block->commands = mm_load_stats.commands;
+        mm_load_block->commands_peak = mm_load_stats.commands_peak;
+    }
+}
+
+// Set the address where the ARM9 wants to receive the statistics
+void mmLoadSetBlock(mm_arm7_load *block)
+{
+    mm_load_block = block;
+    mm_load_enabled = true;
+}
+
+// Get the CPU usage of Maxmod in the ARM7
+void mmGetARM7Load(mm_arm7_load *load)
+{
+    mm_load_enabled = true;
+
+    int old_ime = enterCriticalSection();
+
+    memcpy(load, &mm_load_stats, sizeof(mm_arm7_load));
+
+    leaveCriticalSection(old_ime);
+}
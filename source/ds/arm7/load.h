@@ -0,0 +1,27 @@
+// SPDX-License-Identifier: ISC
+//
+// Copyright (c) 2026, Antonio Niño Díaz (antonio_nd@outlook.com)
+
+#ifndef MM_DS_ARM7_LOAD_H__
+#define MM_DS_ARM7_LOAD_H__
+
+#include <stdbool.h>
+
+#include <nds.h>
+
+#include <mm_types.h>
+
+extern bool mm_load_enabled;
+
+// Current value of the mixer timer, used as start of a measurement
+static inline mm_word mmLoadTimestamp(void)
+{
+    return TIMER_DATA(LIBNDS_DEFAULT_TIMER_MUSIC);
+}
+
+void mmLoadAdd(mm_load_part part, mm_word start);
+void mmLoadCountCommand(void);
+void mmLoadFrameEnd(void);
+void mmLoadSetBlock(mm_arm7_load *block);
+
+#endif // MM_DS_ARM7_LOAD_H__
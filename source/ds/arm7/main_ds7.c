@@ -14,6 +14,7 @@
 #include "core/mixer.h"
 #include "core/player_types.h"
 #include "ds/arm7/comms_ds7.h"
+#include "ds/arm7/load.h"
 #include "ds/arm7/main_ds7.h"
 #include "ds/arm7/mixer.h"
 
@@ -71,6 +72,9 @@ static void mmInitialize(mm_bool do_initialize)
 void mmUnlockChannelsQuick(mm_word mask)
 {
     mm_ch_mask |= mask;
+
+    // The registers may have been modified while the channels were locked
+    mmMixerMarkDirty(mask);
 }
 
 // Unlock audio channels so they can be used by the sequencer.
@@ -196,23 +200,43 @@ void mmInit7(void)
 // Routine function
 void mmFrame(void)
 {
+    mm_word frame_start = mmLoadTimestamp();
+
     if (mmIsInitialized())
     {
         mmMixerPre(); // critical timing
+        mmLoadAdd(MM_LOAD_MIXER_PRE, frame_start);
         REG_IME = 1;
+        mmProcessScheduledCommands(); // commands that are due in this update
         mmUpdateEffects(); // update sound effects
+
+        mm_word start = mmLoadTimestamp();
         mmPulse(); // update module playback
+        mmLoadAdd(MM_LOAD_PLAYER, start);
+
+        start = mmLoadTimestamp();
         mmMixerMix(); // update audio
+        mmLoadAdd(MM_LOAD_MIXER, start);
+
         mmSendUpdateToARM9();
+        mmEffectSendFreed();
     }
 
+    mm_word comms_start = mmLoadTimestamp();
     mmProcessComms();
+
+    if (mmIsInitialized())
+    {
+        mmLoadAdd(MM_LOAD_COMMS, comms_start);
+        mmLoadAdd(MM_LOAD_FRAME, frame_start);
+        mmLoadFrameEnd();
+    }
 }
 
 // Forward event to arm9
 static mm_word mmEventForwarder(mm_word msg, mm_word param)
 {
-    return mmARM9msg(MSG_ARM7_SONG_EVENT, msg | (param << 8));
+    return mmSendSongEvent(msg, param);
 }
 
 // Load memory bank address
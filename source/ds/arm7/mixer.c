@@ -17,8 +17,10 @@
 #include "core/effect.h"
 #include "core/mas.h"
 #include "core/mixer.h"
+#include "ds/arm7/load.h"
 #include "ds/arm7/main_ds7.h"
 #include "ds/arm7/mixer.h"
+#include "ds/common/mode_b.h"
 
 #define SWM_CHANNEL_1 6
 #define SWM_CHANNEL_2 7
@@ -29,6 +31,179 @@ mm_mixer_channel mm_mix_channels[NUM_CHANNELS];
 
 mm_mode_enum mm_mixing_mode = MM_MODE_A;
 
+// Number of ticks of the mixer timer between two updates
+mm_word mm_mix_update_ticks;
+
+// Time mixed since the mixer was initialized, in ticks of a timer with a
+// prescaler of 1024 (about 32.7 kHz). It's advanced at the end of each update.
+mm_word mm_mix_clock;
+
+// Mode requested by mmSelectModeLive(). The mixer switches to it at the start
+// of the next update.
+#define MIX_NO_PENDING_MODE 0xFF
+static mm_byte mm_mix_pending_mode = MIX_NO_PENDING_MODE;
+
+// Bit N is set if mixer channel N continues a sound moved from another mode
+// instead of starting a new note. Its "read" field holds the position to resume
+// from instead of the sample offset.
+static mm_word mm_mix_resume;
+
+// Time between two updates of the mixer in each mode, measured in samples at
+// 32768 Hz (the rate of a channel with a frequency of 1 << MP_SAMPFRAC). In
+// mode B this is the slice length.
+#define MA_TICK_SAMPLES     128
+#define MC_TICK_SAMPLES     (MM_SW_CHUNKLEN * 3 / 2)
+
+// Interpolation kernel used by the resampler of mode B
+mm_byte mm_mix_b_kernel = MM_INTERP_LINEAR;
+
+// Configuration requested for mode B. It's applied when the mode is selected.
+static mm_mode_b_config mm_mix_b_config = { 128, 2, NULL };
+
+// Configuration of mode B in use
+mm_word mm_mix_b_slice_len;                 // Samples per slice
+static mm_word mm_mix_b_slice_count;        // Slices per channel
+static mm_byte *mm_mix_b_output;            // Start of the output buffers
+static mm_word mm_mix_b_channel_size;       // Bytes per channel
+
+// Configuration of mode C
+static mm_word mm_mix_c_hw_voices = MM_MODE_C_HW_VOICES_MAX;
+static mm_word mm_mix_c_sw_voices = MM_MODE_C_SW_VOICES_MAX;
+static mm_word mm_mix_c_locked;             // Channels locked by mmSetModeCVoices()
+static mm_word mm_mix_c_budget;             // Cycles per update, 0 = no limit
+
+// Estimated cost of mixing one audible software channel in mmcMixChunk(), in
+// cycles per update. The inner loop takes about 12 cycles per sample, and the
+// rest is the setup and DMA copy of the sample data. Counted from the
+// instruction timings, not measured on hardware.
+#define MC_VOICE_CYCLES     (12 * MM_SW_CHUNKLEN + 200)
+
+// Bit N is set if mixer channel N belongs to MM_BUS_EFFECTS
+mm_word mm_mix_bus_mask;
+
+// Fields of each hardware channel that have changed since they were written to
+// the sound registers. The MIX_DIRTY_* bits are set when the mixer channel
+// changes and cleared when it's converted to register values. In modes B and C
+// the values go through a shadow first, and the MIX_PUSH_* bits tell
+// mmMixerPre() which shadow fields need to be copied to the registers.
+#define MIX_DIRTY_FREQ  (1 << 0)
+#define MIX_DIRTY_VOL   (1 << 1)
+#define MIX_DIRTY_PAN   (1 << 2)
+#define MIX_DIRTY_ALL   (MIX_DIRTY_FREQ | MIX_DIRTY_VOL | MIX_DIRTY_PAN)
+
+#define MIX_PUSH_SHIFT  4
+#define MIX_PUSH_FREQ   (MIX_DIRTY_FREQ << MIX_PUSH_SHIFT)
+#define MIX_PUSH_VOL    (MIX_DIRTY_VOL << MIX_PUSH_SHIFT)
+#define MIX_PUSH_PAN    (MIX_DIRTY_PAN << MIX_PUSH_SHIFT)
+#define MIX_PUSH_ALL    (MIX_DIRTY_ALL << MIX_PUSH_SHIFT)
+
+static mm_byte mm_mix_dirty[NUM_PHYS_CHANNELS];
+
+// Values seen by the last volume ramp, used to detect changes done directly to
+// the mixer channels by the module player.
+static mm_hword mm_mix_last_freq[NUM_PHYS_CHANNELS];
+static mm_word mm_mix_last_gain[MM_BUS_COUNT];
+
+// Volume and panning ramp. Effect channels (the ones in mm_mix_bus_mask) use
+// their own rate, set when the effect starts. The other channels use the rate
+// of the module.
+static mm_hword mm_mix_ramp_rate[NUM_CHANNELS];
+static mm_hword mm_mix_module_ramp = MM_RAMP_DEFAULT;
+static bool mm_mix_module_instant_attack;
+
+// Force a full register update of the specified hardware channels
+void mmMixerMarkDirty(mm_word mask)
+{
+    for (int i = 0; i < NUM_PHYS_CHANNELS; i++)
+    {
+        if (mask & (1 << i))
+            mm_mix_dirty[i] = MIX_DIRTY_ALL | MIX_PUSH_ALL;
+    }
+}
+
+static inline void mmMixerSetDirty(int channel, mm_byte flags)
+{
+    if (channel < NUM_PHYS_CHANNELS)
+        mm_mix_dirty[channel] |= flags;
+}
+
+// Returns log2 of the number of samples in a word of sample data. ADPCM samples
+// can't be started from an arbitrary position, so their position isn't tracked
+// and this returns -1.
+static int mmSampleWordShift(mm_mas_ds_sample *sample)
+{
+    if (sample->format == MM_SFORMAT_8BIT)
+        return 2;
+    if (sample->format == MM_SFORMAT_16BIT)
+        return 1;
+
+    return -1;
+}
+
+// Set the position of a voice started by a hardware channel from a word of the
+// sample data.
+static void mmHwVoiceSetPosition(mm_mixer_channel *mix_ch,
+                                 mm_mas_ds_sample *sample, mm_word word)
+{
+    int shift = mmSampleWordShift(sample);
+
+    if (shift < 0)
+        mix_ch->read = 0;
+    else
+        mix_ch->read = word << (shift + MP_SAMPFRAC);
+}
+
+// The hardware doesn't report the position of the channels. Estimate it from
+// the frequency of the channel so that the voice can be moved to a different
+// mode later.
+static ARM_CODE void mmHwVoiceTrack(mm_mixer_channel *mix_ch,
+                                    mm_mas_ds_sample *sample, mm_word samples)
+{
+    int shift = mmSampleWordShift(sample);
+    if (shift < 0)
+        return;
+
+    mm_word read = mix_ch->read + mix_ch->freq * samples;
+    mm_word end = (sample->loop_start + sample->length) << (shift + MP_SAMPFRAC);
+
+    if (read >= end)
+    {
+        mm_word loop_length = sample->loop_length << (shift + MP_SAMPFRAC);
+
+        if ((sample->repeat_mode == MM_SREPEAT_FORWARD) && (loop_length > 0))
+        {
+            while (read >= end)
+                read -= loop_length;
+        }
+        else
+        {
+            read = end;
+        }
+    }
+
+    mix_ch->read = read;
+}
+
+// Returns the word of the sample data where a hardware channel has to start to
+// resume a moved voice.
+static mm_word mmHwVoiceResumeOffset(mm_mixer_channel *mix_ch,
+                                     mm_mas_ds_sample *sample)
+{
+    int shift = mmSampleWordShift(sample);
+    if (shift < 0)
+        return 0;
+
+    return mix_ch->read >> (shift + MP_SAMPFRAC);
+}
+
+// Test and clear the resume bit of a channel
+static inline bool mmMixerTakeResume(mm_word channel)
+{
+    bool resume = mm_mix_resume & BIT(channel);
+    mm_mix_resume &= ~BIT(channel);
+    return resume;
+}
+
 // Reset all channels
 static void mm_reset_channels(void)
 {
@@ -79,6 +254,45 @@ static void DisableSWM(void)
     mmLockChannelsQuick(ALL_SOFT_CHANNELS_MASK);
     // Restore Stream channels
     mmUnlockChannelsQuick((1 << SWM_CHANNEL_1) | (1 << SWM_CHANNEL_2));
+    // Restore hardware channels locked by mmSetModeCVoices()
+    mmUnlockChannelsQuick(mm_mix_c_locked & ALL_PHYS_CHANNELS_MASK);
+    mm_mix_c_locked = 0;
+}
+
+// Lock the mode C channels that exceed the configured number of channels, and
+// unlock the ones that have been locked by a previous configuration. The sounds
+// playing in the locked channels are stopped if stop_channels is true.
+static void mmApplyModeCVoices(mm_bool stop_channels)
+{
+    const mm_word stream_mask = (1 << SWM_CHANNEL_1) | (1 << SWM_CHANNEL_2);
+
+    mm_word enabled = 0;
+    mm_word count = mm_mix_c_hw_voices;
+
+    for (int i = 0; (i < NUM_PHYS_CHANNELS) && (count > 0); i++)
+    {
+        if (stream_mask & (1 << i))
+            continue;
+
+        enabled |= 1 << i;
+        count--;
+    }
+
+    enabled |= ((1u << mm_mix_c_sw_voices) - 1) << NUM_PHYS_CHANNELS;
+
+    mm_word disabled = ~(enabled | stream_mask);
+
+    mm_word lock = disabled & mm_ch_mask;
+    mm_word unlock = enabled & mm_mix_c_locked;
+
+    mm_mix_c_locked = (mm_mix_c_locked | lock) & ~unlock;
+
+    if (stop_channels)
+        mmLockChannels(lock);
+    else
+        mmLockChannelsQuick(lock);
+
+    mmUnlockChannelsQuick(unlock);
 }
 
 static void mmSetupModeB(void)
@@ -86,18 +300,30 @@ static void mmSetupModeB(void)
     // Disable timer
     TIMER_CR(MIX_TIMER_NUMBER) = 0;
 
-    mmSetResolution(40960);
+    mm_mix_b_slice_len = mm_mix_b_config.slice_length;
+    mm_mix_b_slice_count = mm_mix_b_config.slice_count;
+    mm_mix_b_channel_size = mm_mix_b_slice_len * mm_mix_b_slice_count * 2;
+
+    mm_mix_b_output = mm_mix_b_config.output;
+
+    // The mixer runs once per slice. The default slice of 128 samples gives a
+    // 256 Hz update rate.
+    mmSetResolution((40960 * 128) / mm_mix_b_slice_len);
 
     mm_word bitmask = mm_ch_mask;
     for (int i = 0; i < NUM_PHYS_CHANNELS; i++)
     {
         if (bitmask & (1 << i))
         {
+            mm_byte *output = mm_mix_b_output + i * mm_mix_b_channel_size;
+
+            memset(output, 0, mm_mix_b_channel_size);
+
             REG_SOUNDXCNT(i) = 0xA8000000;
-            REG_SOUNDXSAD(i) = (uintptr_t)mm_mix_data.mix_data_b.output[i];
+            REG_SOUNDXSAD(i) = (uintptr_t)output;
             REG_SOUNDXTMR(i) = 0xFE00;
             REG_SOUNDXPNT(i) = 0;
-            REG_SOUNDXLEN(i) = MM_MIX_B_NUM_SAMPLES;
+            REG_SOUNDXLEN(i) = mm_mix_b_channel_size / 4;
         }
     }
 
@@ -106,7 +332,9 @@ static void mmSetupModeB(void)
 
     EnableSound();
 
-    TIMER_DATA(MIX_TIMER_NUMBER) = 0xFF80;
+    // One timer tick per output sample (1024 cycles)
+    mm_mix_update_ticks = mm_mix_b_slice_len;
+    TIMER_DATA(MIX_TIMER_NUMBER) = 0x10000 - mm_mix_b_slice_len;
     TIMER_CR(MIX_TIMER_NUMBER) = 0x00C3;
 }
 
@@ -143,6 +371,7 @@ static void SetupSWM(void)
                                    SOUNDXCNT_REPEAT | SOUNDXCNT_FORMAT_16BIT |
                                    SOUNDXCNT_ENABLE;
 
+    mm_mix_update_ticks = 0x10000 - 0xFD60;
     TIMER_DATA(MIX_TIMER_NUMBER) = 0xFD60;
     TIMER_CR(MIX_TIMER_NUMBER) = 0x00C2;
 
@@ -170,12 +399,16 @@ void mmMixerSetVolume(int channel, mm_word volume)
     // doesn't change it later.
     mm_mix_channels[channel].vol = volume;
     mm_mix_channels[channel].cvol = volume;
+
+    mmMixerSetDirty(channel, MIX_DIRTY_VOL);
 }
 
 // Set channel panning
 void mmMixerSetPan(int channel, mm_byte panning)
 {
     mm_mix_channels[channel].tpan = panning >> 1; // Discard one bit
+
+    mmMixerSetDirty(channel, MIX_DIRTY_PAN);
 }
 
 // Set channel frequency
@@ -189,6 +422,8 @@ void mmMixerSetFreq(int channel, mm_word rate)
         freq = 0x1FFF;
 
     mm_mix_channels[channel].freq = freq;
+
+    mmMixerSetDirty(channel, MIX_DIRTY_FREQ);
 }
 
 // Multiply channel frequency by a value
@@ -200,6 +435,80 @@ void mmMixerMulFreq(int channel, mm_word factor)
         freq = 0x1FFF;
 
     mm_mix_channels[channel].freq = freq;
+
+    mmMixerSetDirty(channel, MIX_DIRTY_FREQ);
+}
+
+// Set number of hardware and software channels used in mode C
+mm_bool mmSetModeCVoices(mm_word hardware, mm_word software)
+{
+    if ((hardware > MM_MODE_C_HW_VOICES_MAX) || (software > MM_MODE_C_SW_VOICES_MAX))
+        return false;
+
+    int old_ime = enterCriticalSection();
+
+    mm_mix_c_hw_voices = hardware;
+    mm_mix_c_sw_voices = software;
+
+    if (mm_mixing_mode == MM_MODE_C)
+        mmApplyModeCVoices(true);
+
+    leaveCriticalSection(old_ime);
+
+    return true;
+}
+
+// Set maximum cycles used to mix software channels in mode C
+void mmSetModeCBudget(mm_word cycles)
+{
+    mm_mix_c_budget = cycles;
+}
+
+// Select the interpolation used by mode B
+void mmSetInterpolation(mm_interpolation kernel)
+{
+    if (kernel > MM_INTERP_CUBIC)
+        return;
+
+    mm_mix_b_kernel = kernel;
+}
+
+// Configure mode B. It's applied the next time it's selected.
+mm_bool mmSetModeBConfig(const mm_mode_b_config *config)
+{
+    if (config == NULL)
+    {
+        mm_mix_b_config.slice_length = 128;
+        mm_mix_b_config.slice_count = 2;
+        mm_mix_b_config.output = NULL;
+        return true;
+    }
+
+    if (!mmModeBConfigIsValid(config))
+        return false;
+
+    mm_mix_b_config = *config;
+
+    return true;
+}
+
+// Set volume and panning ramp rate of an effect channel
+void mmMixerSetRamp(int channel, mm_word rate)
+{
+    if (rate > UINT16_MAX)
+        rate = UINT16_MAX;
+
+    mm_mix_ramp_rate[channel] = rate;
+}
+
+// Set volume and panning ramp rate of the module channels
+void mmSetModuleRamp(mm_word rate, mm_bool instant_attack)
+{
+    if (rate > UINT16_MAX)
+        rate = UINT16_MAX;
+
+    mm_mix_module_ramp = rate;
+    mm_mix_module_instant_attack = instant_attack;
 }
 
 // Stop mixing channel
@@ -210,9 +519,22 @@ void mmMixerStopChannel(int channel)
     mm_mix_channels[channel].tpan = 0;
 }
 
+// Mode B needs an output buffer. The ARM9 always gives one, but programs that
+// use the ARM7 API need to set it with mmSetModeBConfig(). Mode A is used if
+// there isn't any.
+static mm_mode_enum mmMixerCheckMode(mm_mode_enum mode)
+{
+    if ((mode == MM_MODE_B) && (mm_mix_b_config.output == NULL))
+        return MM_MODE_A;
+
+    return mode;
+}
+
 // Select audio mode
 void mmSelectMode(mm_mode_enum mode)
 {
+    mode = mmMixerCheckMode(mode);
+
     int old_ime = enterCriticalSection();
 
     // reset mixer channels
@@ -223,12 +545,18 @@ void mmSelectMode(mm_mode_enum mode)
 
     mm_reset_channels();
 
+    mm_mix_bus_mask = 0;
+
+    mmMixerMarkDirty(ALL_PHYS_CHANNELS_MASK);
+
     // Clear volume and enable bit
     REG_SOUNDCNT &= ~(SOUNDCNT_ENABLE | SOUNDCNT_VOL(0xFF));
 
     memset(&mm_mix_data, 0, sizeof(mm_mix_data_ds));
 
     mm_mixing_mode = mode;
+    mm_mix_pending_mode = MIX_NO_PENDING_MODE;
+    mm_mix_resume = 0;
 
     switch (mode)
     {
@@ -238,6 +566,7 @@ void mmSelectMode(mm_mode_enum mode)
             // 256hz resolution
             mmSetResolution(40960);
 
+            mm_mix_update_ticks = 0x10000 - 0xFF80;
             TIMER_DATA(MIX_TIMER_NUMBER) = 0xFF80;
             TIMER_CR(MIX_TIMER_NUMBER) = 0x00C3;
 
@@ -254,6 +583,8 @@ void mmSelectMode(mm_mode_enum mode)
         case MM_MODE_C: // Mode C: Extended mixing
             ClearAllChannels();
             SetupSWM();
+            // Leave only the configured number of channels
+            mmApplyModeCVoices(true);
             EnableSound();
             break;
     }
@@ -261,6 +592,263 @@ void mmSelectMode(mm_mode_enum mode)
     leaveCriticalSection(old_ime);
 }
 
+// Select audio mode without stopping the sounds that are playing
+void mmSelectModeLive(mm_mode_enum mode)
+{
+    mm_mix_pending_mode = mode;
+}
+
+// Software mixed voices are mixed one update ahead of the output. Move the
+// position back to what is being heard now, unless that crosses the start of
+// the sample or the loop point.
+static void mmMixerRewindVoice(mm_mixer_channel *mix_ch,
+                               mm_mas_ds_sample *sample, mm_word samples)
+{
+    mm_word back = mix_ch->freq * samples;
+    if (back > mix_ch->read)
+        return;
+
+    mm_word read = mix_ch->read - back;
+
+    int shift = mmSampleWordShift(sample);
+
+    if ((shift >= 0) && (sample->repeat_mode == MM_SREPEAT_FORWARD))
+    {
+        mm_word loop_start = sample->loop_start << (shift + MP_SAMPFRAC);
+
+        if ((mix_ch->read >= loop_start) && (read < loop_start))
+            return;
+    }
+
+    mix_ch->read = read;
+}
+
+// Move a voice to a different mixer channel. The module channel or sound effect
+// handle that owns it is updated to point to the new channel.
+static void mmMixerMoveVoice(mm_word from, mm_word to)
+{
+    mm_mix_channels[to] = mm_mix_channels[from];
+    memcpy(&mm_achannels[to], &mm_achannels[from], sizeof(mm_active_channel));
+    mm_mix_ramp_rate[to] = mm_mix_ramp_rate[from];
+
+    if (mm_mix_bus_mask & BIT(from))
+        mm_mix_bus_mask |= BIT(to);
+    else
+        mm_mix_bus_mask &= ~BIT(to);
+
+    mm_active_channel *act_ch = &mm_achannels[to];
+
+    if (act_ch->flags & MCAF_EFFECT)
+    {
+        mmEffectMoveChannel(from, to);
+    }
+    else
+    {
+        mm_module_channel *channels;
+        mm_word num_channels;
+
+        if (act_ch->flags & MCAF_SUB)
+        {
+            channels = mm_schannels;
+            num_channels = MP_SCHANNELS;
+        }
+        else
+        {
+            channels = mm_pchannels;
+            num_channels = mm_num_mch;
+        }
+
+        for (mm_word i = 0; i < num_channels; i++)
+        {
+            if (channels[i].alloc == from)
+                channels[i].alloc = to;
+        }
+    }
+
+    mmMixerStopChannel(from);
+    memset(&mm_achannels[from], 0, sizeof(mm_active_channel));
+    mm_mix_bus_mask &= ~BIT(from);
+}
+
+// Switch to a different mode while keeping the voices that are playing. It's
+// called at the start of an update, so the new mode starts at the boundary of
+// a mixing slice.
+//
+// Voices that stay in the same hardware channel keep playing without being
+// touched. The rest are restarted in the new mode from the position they had in
+// the old one. The position of hardware channels is estimated, and it's rounded
+// to a word of sample data. Voices inside a loop restart from the start of the
+// loop when they move to a hardware channel. Voices that are in channels that
+// the new mode doesn't have are moved to free channels, and they are stopped if
+// there aren't enough free channels.
+static void mmMixerSwitchMode(mm_mode_enum mode)
+{
+    mode = mmMixerCheckMode(mode);
+
+    mm_mode_enum old_mode = mm_mixing_mode;
+
+    if (mode == old_mode)
+        return;
+
+    // Software voices of the old mode are ahead of the output by one update
+    mm_word latency = (old_mode == MM_MODE_B) ? mm_mix_b_slice_len : MC_TICK_SAMPLES;
+
+    for (mm_word i = 0; i < NUM_CHANNELS; i++)
+    {
+        mm_mixer_channel *mix_ch = &mm_mix_channels[i];
+
+        // Notes that haven't started yet don't have a position
+        if ((mix_ch->samp == 0) || mix_ch->key_on)
+            continue;
+
+        mm_mas_ds_sample *sample = (mm_mas_ds_sample *)(mix_ch->samp + 0x2000000);
+
+        bool old_hw = (i < NUM_PHYS_CHANNELS) && (old_mode != MM_MODE_B);
+
+        if (old_hw)
+        {
+            if ((REG_SOUNDXCNT(i) & SOUNDXCNT_ENABLE) == 0)
+            {
+                mmMixerStopChannel(i);
+                continue;
+            }
+        }
+        else
+        {
+            mmMixerRewindVoice(mix_ch, sample, latency);
+        }
+
+        // Voices that have reached the end can't be resumed
+        int shift = mmSampleWordShift(sample);
+        if ((shift >= 0) && (sample->repeat_mode != MM_SREPEAT_FORWARD))
+        {
+            if ((mix_ch->read >> (shift + MP_SAMPFRAC)) >= sample->length)
+                mmMixerStopChannel(i);
+        }
+    }
+
+    memset(&mm_mix_data, 0, sizeof(mm_mix_data_ds));
+
+    mm_mixing_mode = mode;
+
+    switch (mode)
+    {
+        case MM_MODE_A:
+            DisableSWM();
+
+            mmSetResolution(40960);
+
+            TIMER_CR(MIX_TIMER_NUMBER) = 0;
+            mm_mix_update_ticks = 0x10000 - 0xFF80;
+            TIMER_DATA(MIX_TIMER_NUMBER) = 0xFF80;
+            TIMER_CR(MIX_TIMER_NUMBER) = 0x00C3;
+            break;
+
+        case MM_MODE_B:
+            DisableSWM();
+            mmSetupModeB();
+            break;
+
+        default:
+        case MM_MODE_C:
+            SetupSWM();
+            // The voices of the channels that are locked are moved below
+            mmApplyModeCVoices(false);
+            break;
+    }
+
+    EnableSound();
+
+    // Decide what to do with each voice in the new mode
+
+    mm_word mask = mm_ch_mask;
+    mm_word keep = 0; // Voices that continue in the same hardware channel
+    mm_word used = 0; // Channels that have a voice
+
+    for (mm_word i = 0; i < NUM_CHANNELS; i++)
+    {
+        if ((mask & BIT(i)) && (mm_mix_channels[i].samp != 0))
+            used |= BIT(i);
+    }
+
+    for (mm_word i = 0; i < NUM_CHANNELS; i++)
+    {
+        mm_mixer_channel *mix_ch = &mm_mix_channels[i];
+
+        if (mix_ch->samp == 0)
+            continue;
+
+        bool was_key_on = mix_ch->key_on;
+        mm_word channel = i;
+
+        if ((mask & BIT(i)) == 0)
+        {
+            // Look for a free channel in the new mode
+            channel = NO_CHANNEL_AVAILABLE;
+
+            for (mm_word j = 0; j < NUM_CHANNELS; j++)
+            {
+                if (((mask & ~used) & BIT(j)) == 0)
+                    continue;
+
+                if (mm_achannels[j].type != ACHN_DISABLED)
+                    continue;
+
+                channel = j;
+                break;
+            }
+
+            if (channel == NO_CHANNEL_AVAILABLE)
+            {
+                // Stop the voice and free its channel
+                mmLockChannels(BIT(i));
+                continue;
+            }
+
+            mmMixerMoveVoice(i, channel);
+            used |= BIT(channel);
+        }
+        else if ((i < NUM_PHYS_CHANNELS) && (old_mode != MM_MODE_B) &&
+                 (mode != MM_MODE_B))
+        {
+            // Keep playing in the same hardware channel
+            if (!was_key_on)
+                keep |= BIT(i);
+            continue;
+        }
+
+        // Restart the voice from its current position
+        mm_mix_channels[channel].key_on = 1;
+        if (!was_key_on)
+            mm_mix_resume |= BIT(channel);
+    }
+
+    // Silence the hardware channels that don't continue a voice. In mode B all
+    // of them have been set up to play the output of the mixer.
+    if (mode != MM_MODE_B)
+    {
+        for (mm_word i = 0; i < NUM_PHYS_CHANNELS; i++)
+        {
+            if ((mode == MM_MODE_C) && ((i == SWM_CHANNEL_1) || (i == SWM_CHANNEL_2)))
+                continue;
+
+            if ((keep & BIT(i)) == 0)
+                REG_SOUNDXCNT(i) = 0;
+        }
+    }
+
+    mmMixerMarkDirty(ALL_PHYS_CHANNELS_MASK);
+
+    // The shadow registers of mode C have been cleared. mmMixerPre() runs
+    // before mmMixC() rebuilds them, so the channels that keep playing must
+    // not push them to the hardware until then.
+    for (mm_word i = 0; i < NUM_PHYS_CHANNELS; i++)
+    {
+        if (keep & BIT(i))
+            mm_mix_dirty[i] &= ~MIX_PUSH_ALL;
+    }
+}
+
 // Update hardware data
 //
 // NOTE: Keep this function as Thumb so that SlideMixingLevels() can jump to it
@@ -279,12 +867,14 @@ void mmMixerPre(void)
 
         for (int i = 0; i < NUM_PHYS_CHANNELS; i++)
         {
-            if (channels & 1)
+            if ((channels & 1) && (mm_mix_dirty[i] & MIX_PUSH_VOL))
             {
                 // Read shadow SOUNDCNT
                 mm_word shadow = *(mm_word *)&(mm_mix_data.mix_data_b.shadow[i]);
                 REG_SOUNDXCNT(i) = SOUNDXCNT_ENABLE | shadow |
                                    SOUNDXCNT_REPEAT | SOUNDXCNT_FORMAT_16BIT;
+
+                mm_mix_dirty[i] &= ~MIX_PUSH_ALL;
             }
 
             channels >>= 1;
@@ -304,6 +894,8 @@ void mmMixerPre(void)
             {
                 mmshadow_c_ds *shadow = &(mm_mix_data.mix_data_c.shadow[0]);
 
+                mm_word push = mm_mix_dirty[i];
+
                 if (shadow[i].src != 0)
                 {
                     REG_SOUNDXCNT(i) = 0;
@@ -315,14 +907,22 @@ void mmMixerPre(void)
                     REG_SOUNDXCNT(i) = shadow[i].cnt;
 
                     shadow[i].src = 0;
+
+                    push = MIX_PUSH_ALL;
                 }
 
-                REG_SOUNDXTMR(i) = shadow[i].tmr;
+                if (push & MIX_PUSH_FREQ)
+                    REG_SOUNDXTMR(i) = shadow[i].tmr;
+
+                if (push & MIX_PUSH_PAN)
+                    REG_SOUNDXPAN(i) = shadow[i].cnt >> 16;
 
-                REG_SOUNDXPAN(i) = shadow[i].cnt >> 16;
                 // Use a mm_hword pointer so that we can update the volume
                 // multipler and divider fields.
-                *(mm_hword*)&(REG_SOUNDXVOL(i)) = shadow[i].cnt;
+                if (push & MIX_PUSH_VOL)
+                    *(mm_hword*)&(REG_SOUNDXVOL(i)) = shadow[i].cnt;
+
+                mm_mix_dirty[i] &= ~MIX_PUSH_ALL;
             }
 
             channels >>= 1;
@@ -333,67 +933,127 @@ void mmMixerPre(void)
 }
 
 // Slide volume and panning levels towards target levels for all channels.
-static ARM_CODE void SlideMixingLevels(mm_word throttle)
+static ARM_CODE void SlideMixingLevels(void)
 {
     mm_mixer_channel *mix_ch = &mm_mix_channels[0];
 
+    // A change of bus gain affects the volume of all channels
+    mm_byte gain_dirty = 0;
+
+    for (int i = 0; i < MM_BUS_COUNT; i++)
+    {
+        if (mm_mix_last_gain[i] != mm_bus_gain[i])
+        {
+            mm_mix_last_gain[i] = mm_bus_gain[i];
+            gain_dirty = MIX_DIRTY_VOL;
+        }
+    }
+
     for (mm_word i = 0; i < NUM_CHANNELS; i++, mix_ch++)
     {
-        // Slide volume
+        // The levels of stopped channels are set when a note starts
+        if (mix_ch->samp == 0)
+            continue;
+
+        mm_byte dirty = gain_dirty;
 
-        // volume += (target - volume) * throttle
         mm_sword target_volume = mix_ch->vol;
         mm_sword volume = mix_ch->cvol;
 
-        if (volume < target_volume)
-        {
-            // TODO: Is this ok? Shouldn't this check bounds as well?
-            volume += ((target_volume - volume) >> 2);
+        mm_sword target_panning = mix_ch->tpan << 9;
+        mm_sword panning = mix_ch->cpan;
 
-            // volume += throttle
-            // if (volume > target_volume)
-            //     volume = target_volume;
-        }
-        else
+        // Most of the time the channels are already at their target levels
+        if ((volume != target_volume) || (panning != target_panning))
         {
-            volume -= throttle;
-            if (volume < target_volume)
+            mm_sword rate;
+            bool instant_attack;
+
+            if (mm_mix_bus_mask & BIT(i))
+            {
+                rate = mm_mix_ramp_rate[i];
+                instant_attack = false;
+            }
+            else
+            {
+                rate = mm_mix_module_ramp;
+                instant_attack = mm_mix_module_instant_attack;
+            }
+
+            if (rate == MM_RAMP_OFF)
+            {
                 volume = target_volume;
-        }
+                panning = target_panning;
+            }
+            else
+            {
+                // Slide volume
 
-        // volume += ((target_volume - volume) * throttle) >> 8;
+                if (volume < target_volume)
+                {
+                    // volume += (target - volume) / 4. The steps become zero
+                    // close to the target, so finish the slide then.
+                    mm_sword step = (target_volume - volume) >> 2;
+
+                    if (instant_attack || (step == 0))
+                        volume = target_volume;
+                    else
+                        volume += step;
+                }
+                else
+                {
+                    volume -= rate;
+                    if (volume < target_volume)
+                        volume = target_volume;
+                }
 
-        mix_ch->cvol = volume;
+                // Slide panning
 
-        // Slide panning
+                if (panning < target_panning)
+                {
+                    panning += rate;
+                    if (panning > target_panning)
+                        panning = target_panning;
+                }
+                else
+                {
+                    panning -= rate;
+                    if (panning < target_panning)
+                        panning = target_panning;
+                }
+            }
 
-        // pan += (target - pan) * throttle
-        mm_sword target_panning = mix_ch->tpan << 9;
-        mm_sword panning = mix_ch->cpan;
+            if (volume != mix_ch->cvol)
+            {
+                mix_ch->cvol = volume;
+                dirty |= MIX_DIRTY_VOL;
+            }
 
-        if (panning < target_panning)
-        {
-            panning += throttle;
-            if (panning > target_panning)
-                panning = target_panning;
+            if (panning != mix_ch->cpan)
+            {
+                mix_ch->cpan = panning;
+                dirty |= MIX_DIRTY_PAN;
+            }
         }
-        else
+
+        // Only hardware channels use the dirty flags. The frequency is written
+        // by the module player directly, so it's checked here.
+
+        if (i >= NUM_PHYS_CHANNELS)
+            continue;
+
+        if (mix_ch->freq != mm_mix_last_freq[i])
         {
-            panning -= throttle;
-            if (panning < target_panning)
-                panning = target_panning;
+            mm_mix_last_freq[i] = mix_ch->freq;
+            dirty |= MIX_DIRTY_FREQ;
         }
 
-        // panning += ((target_panning - panning) * throttle) >> 8;
-
-        mix_ch->cpan = panning;
+        mm_mix_dirty[i] |= dirty;
     }
 
     mmMixerPre();
 }
 
-#define SLIDE_THROTTLE 6144 //45
-
 // LUTs containing values to help convert a certain value into value and shift
 // amount for the hardware channels.
 
@@ -415,8 +1075,97 @@ static ARM_CODE mm_word translateVolume(mm_word volume) // volume = 0..65535
     return (shift_data << 8) | (volume >> shift_level);
 }
 
+// Scale a channel volume by the gain of the bus it belongs to
+static inline mm_word mmApplyBusGain(mm_word channel, mm_word volume)
+{
+    return (volume * mm_bus_gain[(mm_mix_bus_mask >> channel) & 1]) >> 8;
+}
+
 #define CLK_DIV 524288 // VALUE = 16777216 * CLK / 512 / 32
 
+// Reciprocals of the mantissa of the frequency, used to calculate CLK_DIV / freq
+// without a division (the ARM7 doesn't have a hardware divider). Entry N is
+// round(2^28 / M), where M is the center of the range [4096 + 32 * N,
+// 4096 + 32 * N + 31].
+static const mm_hword mmClockDivTable[128] = {
+    65281, 64777, 64281, 63792, 63310, 62836, 62369, 61909,
+    61455, 61008, 60568, 60133, 59705, 59283, 58867, 58457,
+    58053, 57654, 57260, 56872, 56489, 56111, 55738, 55370,
+    55007, 54649, 54295, 53946, 53601, 53261, 52925, 52593,
+    52265, 51942, 51622, 51306, 50995, 50686, 50382, 50081,
+    49784, 49490, 49200, 48913, 48630, 48349, 48072, 47798,
+    47528, 47260, 46995, 46733, 46474, 46218, 45965, 45714,
+    45467, 45222, 44979, 44739, 44502, 44267, 44035, 43805,
+    43577, 43352, 43129, 42908, 42690, 42474, 42260, 42048,
+    41838, 41631, 41425, 41222, 41020, 40820, 40623, 40427,
+    40233, 40041, 39851, 39662, 39476, 39291, 39108, 38926,
+    38746, 38568, 38392, 38217, 38044, 37872, 37702, 37533,
+    37366, 37200, 37036, 36873, 36712, 36552, 36393, 36236,
+    36080, 35926, 35772, 35620, 35470, 35320, 35172, 35026,
+    34880, 34735, 34592, 34450, 34309, 34169, 34031, 33893,
+    33757, 33622, 33487, 33354, 33222, 33091, 32961, 32832,
+};
+
+// Returns CLK_DIV / freq, rounded down like the division
+static ARM_CODE mm_word mmClockDivide(mm_word freq)
+{
+    // The table only covers 1..0x1FFF. Higher frequencies are rare, and the
+    // result is small enough that the division is cheap.
+    if (freq >= 0x2000)
+        return CLK_DIV / freq;
+
+    // Like the division by zero of the ARM runtime
+    if (freq == 0)
+        return 0;
+
+    // Normalize the frequency so that it's in the range 4096..8191
+
+    mm_word mant = freq;
+    mm_word shift = 0;
+
+    if (mant < (1 << 6))
+    {
+        mant <<= 6;
+        shift += 6;
+    }
+    if (mant < (1 << 9))
+    {
+        mant <<= 3;
+        shift += 3;
+    }
+    if (mant < (1 << 11))
+    {
+        mant <<= 2;
+        shift += 2;
+    }
+    if (mant < (1 << 12))
+    {
+        mant <<= 1;
+        shift += 1;
+    }
+
+    mm_sword recip = mmClockDivTable[(mant >> 5) - 128];
+
+    // Initial estimate, accurate to about 1/256 of the result
+    mm_word quotient = (recip << shift) >> 9;
+
+    // Two refinement steps using the remainder. Each one increases the accuracy
+    // by the same factor, so the result is off by one at most.
+    for (int i = 0; i < 2; i++)
+    {
+        mm_sword remainder = CLK_DIV - (mm_sword)(quotient * freq);
+        quotient += (remainder * recip) >> (28 - shift);
+    }
+
+    mm_sword remainder = CLK_DIV - (mm_sword)(quotient * freq);
+    if (remainder < 0)
+        quotient--;
+    else if (remainder >= (mm_sword)freq)
+        quotient++;
+
+    return quotient;
+}
+
 static ARM_CODE void mmMixA(void)
 {
     mm_word ch_mask = mm_ch_mask & 0xFFFF; // 16 channels only
@@ -436,6 +1185,8 @@ static ARM_CODE void mmMixA(void)
         // Get mainram address
         mm_mas_ds_sample *sample = (mm_mas_ds_sample *)(mix_ch->samp + 0x2000000);
 
+        mm_byte dirty = mm_mix_dirty[channel];
+
         if (mix_ch->key_on) // If KEY-ON is cleared, continue activity
         {
             // start new note
@@ -443,31 +1194,50 @@ static ARM_CODE void mmMixA(void)
 
             mix_ch->key_on = 0; // Clear start bit
 
-            // When the note starts "mix_ch->read" contains the sample offset
-            // obtained from "mpp_vars.sampoff", which comes from the effects in
-            // the module. The module player doesn't know how many bytes to skip
-            // because the DS supports 8-bit and 16-bit samples, so we need to
-            // calculate it here when the note starts.
-            //
-            // Note: Only the least significant byte of "mix_ch->read" contains
-            // the offset, and the value read must be multiplied by 256 samples.
-            mm_word offset = (mm_byte)mix_ch->read;
-
-            if (offset != 0)
+            // The registers have been reset, write all fields
+            dirty = MIX_DIRTY_ALL;
+
+            bool resume = mmMixerTakeResume(channel);
+
+            mm_word offset;
+
+            if (resume)
             {
-                // Test sample format
-                if (sample->format == MM_SFORMAT_8BIT)
-                    offset = offset << (8 - 2); // 8-bit = LSL 0
-                if (sample->format == MM_SFORMAT_16BIT)
-                    offset = offset << (9 - 2); // 16-bit = LSL 1
-                else
-                    offset = 0; // ADPCM/other = invalid
+                // Continue a voice moved from another mode
+                offset = mmHwVoiceResumeOffset(mix_ch, sample);
+            }
+            else
+            {
+                // When the note starts "mix_ch->read" contains the sample
+                // offset obtained from "mpp_vars.sampoff", which comes from the
+                // effects in the module. The module player doesn't know how
+                // many bytes to skip because the DS supports 8-bit and 16-bit
+                // samples, so we need to calculate it here when the note
+                // starts.
+                //
+                // Note: Only the least significant byte of "mix_ch->read"
+                // contains the offset, and the value read must be multiplied by
+                // 256 samples.
+                offset = (mm_byte)mix_ch->read;
+
+                if (offset != 0)
+                {
+                    // Test sample format
+                    if (sample->format == MM_SFORMAT_8BIT)
+                        offset = offset << (8 - 2); // 8-bit = LSL 0
+                    if (sample->format == MM_SFORMAT_16BIT)
+                        offset = offset << (9 - 2); // 16-bit = LSL 1
+                    else
+                        offset = 0; // ADPCM/other = invalid
+                }
             }
 
             mm_byte *sampledata = (mm_byte *)sample->point; // get sampledata pointer
             if (sampledata == NULL)
                 sampledata = sample->data;
 
+            mm_byte *sample_start = sampledata;
+
             sampledata += (offset << 2); // add sample offset (in bytes)
 
             mm_byte rep_mode = sample->repeat_mode; // check repeat mode
@@ -511,11 +1281,18 @@ static ARM_CODE void mmMixA(void)
                 REG_SOUNDXLEN(channel) = remaining_len;
             }
 
+            // Remember the position to be able to move the voice later
+            mmHwVoiceSetPosition(mix_ch, sample, (sampledata - sample_start) >> 2);
+
             // mma_copy_levels
 
-            // Set direct volume levels on key-on
-            mix_ch->cvol = mix_ch->vol;
-            mix_ch->cpan = mix_ch->tpan << 9;
+            // Set direct volume levels on key-on. Moved voices keep their
+            // current levels.
+            if (!resume)
+            {
+                mix_ch->cvol = mix_ch->vol;
+                mix_ch->cpan = mix_ch->tpan << 9;
+            }
 
             REG_SOUNDXCNT(channel) = SOUNDXCNT_ENABLE |
                 (sample->repeat_mode | (sample->format << 2)) << 27;
@@ -535,22 +1312,33 @@ static ARM_CODE void mmMixA(void)
                 mix_ch->key_on = 0;
                 continue;
             }
+
+            mmHwVoiceTrack(mix_ch, sample, MA_TICK_SAMPLES);
         }
 
         // mma_started
         // -----------
 
+        // Only write the fields that have changed
+
+        mm_mix_dirty[channel] = 0;
+
         // Set timer
-        if (mix_ch->freq == 0)
-            REG_SOUNDXTMR(channel) = 0;
-        else
-            REG_SOUNDXTMR(channel) = -(CLK_DIV / mix_ch->freq);
+        if (dirty & MIX_DIRTY_FREQ)
+        {
+            if (mix_ch->freq == 0)
+                REG_SOUNDXTMR(channel) = 0;
+            else
+                REG_SOUNDXTMR(channel) = -(mmClockDivide(mix_ch->freq));
+        }
 
         // Set volume levels
-        *(mm_hword*)&REG_SOUNDXCNT(channel) = translateVolume(mix_ch->cvol);
+        if (dirty & MIX_DIRTY_VOL)
+            *(mm_hword*)&REG_SOUNDXCNT(channel) = translateVolume(mmApplyBusGain(channel, mix_ch->cvol));
 
         // Set panning levels. Use top 7 bits.
-        REG_SOUNDXPAN(channel) = mix_ch->cpan >> 9;
+        if (dirty & MIX_DIRTY_PAN)
+            REG_SOUNDXPAN(channel) = mix_ch->cpan >> 9;
     }
 }
 
@@ -561,11 +1349,11 @@ void mmbResampleData(mm_addr dest, mm_word do_zero_padding, mm_word *shadow,
 static mm_addr mmb_getdest(mm_word channel)
 {
     // Calc destination address...
-    mm_byte *dest = &(mm_mix_data.mix_data_b.output[0][0]) + (channel * 512);
+    mm_byte *dest = mm_mix_b_output + (channel * mm_mix_b_channel_size);
 
     mm_word slice = mm_output_slice;
 
-    return dest + (slice << 8); // add output slice offset
+    return dest + (slice * mm_mix_b_slice_len * 2); // add output slice offset
 }
 
 static void ARM_CODE mmMixB(void)
@@ -573,7 +1361,8 @@ static void ARM_CODE mmMixB(void)
     mm_word ch_mask = mm_ch_mask & 0xFFFF; // Clear top 16 bits (only 16 channels)
     mm_mixer_channel *mix_ch = &mm_mix_channels[0];
 
-    REG_DMA1_DEST = (mm_word)&(mm_mix_data.mix_data_b.fetch[0]);
+    // The fetch starts one word before the data that is resampled
+    REG_DMA1_DEST = (mm_word)&(mm_mix_data.mix_data_b.history[0]);
 
     // Get mode B shadow data (word pointer, don't access individual fields)
     mm_word *shadow = (mm_word *)&(mm_mix_data.mix_data_b.shadow[0]);
@@ -585,7 +1374,12 @@ static void ARM_CODE mmMixB(void)
 
         if (mix_ch->samp == 0) // Check if channel is disabled
         {
-            *shadow = SOUNDXCNT_PAN(64) | SOUNDXCNT_VOL_MUL(0); // pan=center, vol=silent
+            mm_word silent = SOUNDXCNT_PAN(64) | SOUNDXCNT_VOL_MUL(0); // pan=center, vol=silent
+            if (*shadow != silent)
+            {
+                *shadow = silent;
+                mm_mix_dirty[i] |= MIX_PUSH_VOL;
+            }
             mmbZerofillBuffer(mmb_getdest(i)); // zero wavebuffer
             continue;
         }
@@ -593,29 +1387,36 @@ static void ARM_CODE mmMixB(void)
         // The channel is active
 
         mm_byte do_zero_padding;
+        mm_byte dirty = mm_mix_dirty[i];
 
         if (mix_ch->key_on == 1)
         {
             // New note
             mix_ch->key_on = 0; // clear start bit
 
-            mm_word vol = mix_ch->vol;
-            mm_word pan = mix_ch->tpan;
+            dirty |= MIX_DIRTY_ALL;
 
-            mix_ch->cvol = vol | (pan << (16 + 9));
-
-            // When the note starts "mix_ch->read" contains the sample offset
-            // obtained from "mpp_vars.sampoff", which comes from the effects in
-            // the module. The module player doesn't know how many bytes to skip
-            // because the DS supports 8-bit and 16-bit samples, so we need to
-            // calculate it here when the note starts.
-            //
-            // Note: Only the least significant byte of "mix_ch->read" contains
-            // the offset, and the value read must be multiplied by 256 samples.
-            //
-            // TODO: Mode B doesn't support 16-bit samples, is that a bug?
-            mm_word offset = (mm_byte)mix_ch->read;
-            mix_ch->read = offset << (8 + MP_SAMPFRAC);
+            // Voices moved from another mode keep their position and levels
+            if (!mmMixerTakeResume(i))
+            {
+                mm_word vol = mix_ch->vol;
+                mm_word pan = mix_ch->tpan;
+
+                mix_ch->cvol = vol | (pan << (16 + 9));
+
+                // When the note starts "mix_ch->read" contains the sample
+                // offset obtained from "mpp_vars.sampoff", which comes from the
+                // effects in the module. The module player doesn't know how
+                // many bytes to skip because the DS supports 8-bit and 16-bit
+                // samples, so we need to calculate it here when the note
+                // starts.
+                //
+                // Note: Only the least significant byte of "mix_ch->read"
+                // contains the offset, and the value read must be multiplied by
+                // 256 samples.
+                mm_word offset = (mm_byte)mix_ch->read;
+                mix_ch->read = offset << (8 + MP_SAMPFRAC);
+            }
 
             do_zero_padding = 1; // add zero padding
         }
@@ -625,28 +1426,83 @@ static void ARM_CODE mmMixB(void)
         }
 
         // Do volume ramping
+        if (dirty & (MIX_DIRTY_VOL | MIX_DIRTY_PAN))
         {
             // get volume+shift value
-            mm_word volume = translateVolume(mix_ch->cvol);
+            mm_word volume = translateVolume(mmApplyBusGain(i, mix_ch->cvol));
 
             // assemble volume|shift|panning
             mm_hword pan = mix_ch->cpan >> 9;
 
             // -write to shadow
-            *shadow = volume | (pan << 16);
+            mm_word value = volume | (pan << 16);
+            if (*shadow != value)
+            {
+                *shadow = value;
+                dirty |= MIX_PUSH_VOL;
+            }
         }
 
+        // The frequency isn't used, the data is resampled by the mixer
+        mm_mix_dirty[i] = dirty & ~MIX_DIRTY_ALL;
+
         mm_addr dest = mmb_getdest(i); // fill wave buffer
 
         mmbResampleData(dest, do_zero_padding, shadow, mix_ch);
     }
 
-    // Swap mixing slice
-    mm_output_slice ^= 1;
+    // Move to the next mixing slice
+    mm_output_slice++;
+    if (mm_output_slice == mm_mix_b_slice_count)
+        mm_output_slice = 0;
 }
 
 void mmcMixChunk(void);
 
+// Stop the quietest software channels until the estimated cost of mixing them
+// fits in the budget. Silent channels are almost free, so they aren't counted.
+static void mmcApplyBudget(mm_word ch_mask)
+{
+    mm_word max_voices = mm_mix_c_budget / MC_VOICE_CYCLES;
+
+    while (1)
+    {
+        mm_word voices = 0;
+        mm_word quietest_volume = UINT32_MAX;
+        int quietest_channel = -1;
+
+        for (int i = NUM_PHYS_CHANNELS; i < NUM_CHANNELS; i++)
+        {
+            if ((ch_mask & BIT(i)) == 0)
+                continue;
+
+            mm_mixer_channel *mix_ch = &mm_mix_channels[i];
+
+            if (mix_ch->samp == 0)
+                continue;
+
+            mm_word volume = mmApplyBusGain(i, mix_ch->cvol);
+            if (volume == 0)
+                continue;
+
+            voices++;
+
+            if (volume < quietest_volume)
+            {
+                quietest_volume = volume;
+                quietest_channel = i;
+            }
+        }
+
+        if (voices <= max_voices)
+            break;
+
+        // The module player and the effect system free the channel when they
+        // see that it has stopped.
+        mmMixerStopChannel(quietest_channel);
+    }
+}
+
 static ARM_CODE void mmMixC(void)
 {
     mm_word ch_mask = mm_ch_mask;
@@ -665,6 +1521,10 @@ static ARM_CODE void mmMixC(void)
             // Silence channel if it's a hardware channel
             if (channel < 16)
             {
+                // mmMixerPre() only writes the volume when it's pushed
+                if (shadow->cnt != 0)
+                    mm_mix_dirty[channel] |= MIX_PUSH_VOL | MIX_PUSH_PAN;
+
                 shadow->cnt = 0;
                 mix_ch->samp = 0;
                 mix_ch->tpan = 0;
@@ -682,30 +1542,47 @@ static ARM_CODE void mmMixC(void)
 
         if (was_key_on) // Continue channel / start new note
         {
-            // shift sample offset (for swm only): offset / 256
-
-            // When the note starts "mix_ch->read" contains the sample offset
-            // obtained from "mpp_vars.sampoff", which comes from the effects in
-            // the module. The module player doesn't know how many bytes to skip
-            // because the DS supports 8-bit and 16-bit samples, so we need to
-            // calculate it here when the note starts.
-            //
-            // Note: Only the least significant byte of "mix_ch->read" contains
-            // the offset, and the value read must be multiplied by 256 samples.
-            mm_word sample_offset = (mm_byte)mix_ch->read;
+            // Voices moved from another mode keep their position and levels
+            bool resume = mmMixerTakeResume(channel);
 
-            mix_ch->read = sample_offset << (MP_SAMPFRAC + 8);
+            mm_word sample_offset = 0;
 
-            // set direct volume levels on key-on
-            mix_ch->cvol = mix_ch->vol;
-            mix_ch->cpan = mix_ch->tpan << 9;
+            if (!resume)
+            {
+                // shift sample offset (for swm only): offset / 256
+
+                // When the note starts "mix_ch->read" contains the sample
+                // offset obtained from "mpp_vars.sampoff", which comes from the
+                // effects in the module. The module player doesn't know how
+                // many bytes to skip because the DS supports 8-bit and 16-bit
+                // samples, so we need to calculate it here when the note
+                // starts.
+                //
+                // Note: Only the least significant byte of "mix_ch->read"
+                // contains the offset, and the value read must be multiplied by
+                // 256 samples.
+                sample_offset = (mm_byte)mix_ch->read;
+
+                mix_ch->read = sample_offset << (MP_SAMPFRAC + 8);
+
+                // set direct volume levels on key-on
+                mix_ch->cvol = mix_ch->vol;
+                mix_ch->cpan = mix_ch->tpan << 9;
+            }
 
             if (channel >= 16) // skip the rest for software channels
                 continue;
 
+            // mmMixerPre() writes all registers when a note starts
+            mm_mix_dirty[channel] |= MIX_DIRTY_ALL;
+
             mm_sword length = sample_offset;
 
-            if (sample_offset != 0) // convert sample offset into word count
+            if (resume)
+            {
+                length = mmHwVoiceResumeOffset(mix_ch, sample);
+            }
+            else if (sample_offset != 0) // convert sample offset into word count
             {
                 if (sample->format == MM_SFORMAT_8BIT)
                     length = length << (8 - 2); // 8-bit = lsl #0
@@ -719,6 +1596,8 @@ static ARM_CODE void mmMixC(void)
             if (source_addr == 0)
                 source_addr = (mm_word)&(sample->data[0]);
 
+            mm_word sample_start = source_addr;
+
             source_addr += length << 2;
 
             mm_sword loop_start;
@@ -755,6 +1634,9 @@ static ARM_CODE void mmMixC(void)
             shadow->src = source_addr;
             shadow->pnt = loop_start;
 
+            // Remember the position to be able to move the voice later
+            mmHwVoiceSetPosition(mix_ch, sample, (source_addr - sample_start) >> 2);
+
             // Combine and add start bit
             shadow->cnt &= 0x00FFFFFF;
             shadow->cnt |= (sample->repeat_mode << 27) | (sample->format << 29) |
@@ -779,30 +1661,63 @@ static ARM_CODE void mmMixC(void)
                 }
                 continue;
             }
+
+            mmHwVoiceTrack(mix_ch, sample, MC_TICK_SAMPLES);
         }
 
+        mm_byte dirty = mm_mix_dirty[channel];
+
         // calc & set timer
-        if (mix_ch->freq == 0)
-            shadow->tmr = 0;
-        else
-            shadow->tmr = -(CLK_DIV / mix_ch->freq);
+        if (dirty & MIX_DIRTY_FREQ)
+        {
+            if (mix_ch->freq == 0)
+                shadow->tmr = 0;
+            else
+                shadow->tmr = -(mmClockDivide(mix_ch->freq));
+
+            dirty |= MIX_PUSH_FREQ;
+        }
+
+        if (dirty & (MIX_DIRTY_VOL | MIX_DIRTY_PAN))
+        {
+            shadow->cnt &= 0xFF000000;
+            shadow->cnt |= translateVolume(mmApplyBusGain(channel, mix_ch->cvol));
+            shadow->cnt |= ((mm_word)mix_ch->cpan & 0xFE00) << (16 - 9);
 
-        shadow->cnt &= 0xFF000000;
-        shadow->cnt |= translateVolume(mix_ch->cvol);
-        shadow->cnt |= ((mm_word)mix_ch->cpan & 0xFE00) << (16 - 9);
+            dirty |= MIX_PUSH_VOL | MIX_PUSH_PAN;
+        }
+
+        mm_mix_dirty[channel] = dirty & ~MIX_DIRTY_ALL;
     }
 
+    if (mm_mix_c_budget != 0)
+        mmcApplyBudget(ch_mask);
+
     // Setup DMA destination
     REG_DMA1_DEST = (mm_word)&(mm_mix_data.mix_data_c.fetch[0]);
 
     // Software mix extended channels into the streams.
+    mm_word start = mmLoadTimestamp();
     mmcMixChunk();
+    mmLoadAdd(MM_LOAD_SOFTWARE_MIX, start);
 }
 
 ARM_CODE void mmMixerMix(void)
 {
+    // Switch modes before anything is mixed, so that the new mode starts at the
+    // boundary of a mixing slice.
+    if (mm_mix_pending_mode != MIX_NO_PENDING_MODE)
+    {
+        int old_ime = enterCriticalSection();
+
+        mmMixerSwitchMode(mm_mix_pending_mode);
+        mm_mix_pending_mode = MIX_NO_PENDING_MODE;
+
+        leaveCriticalSection(old_ime);
+    }
+
     // Do volume ramping
-    SlideMixingLevels(SLIDE_THROTTLE);
+    SlideMixingLevels();
 
     if (mm_mixing_mode == MM_MODE_A)
     {
@@ -810,10 +1725,19 @@ ARM_CODE void mmMixerMix(void)
     }
     else if (mm_mixing_mode == MM_MODE_B)
     {
+        // Most of the time is spent resampling the channels
+        mm_word start = mmLoadTimestamp();
         mmMixB();
+        mmLoadAdd(MM_LOAD_SOFTWARE_MIX, start);
     }
     else // if (mm_mixing_mode == MM_MODE_C)
     {
         mmMixC();
     }
+
+    // The timer of mode C uses a prescaler of 256 instead of 1024
+    if (mm_mixing_mode == MM_MODE_C)
+        mm_mix_clock += mm_mix_update_ticks >> 2;
+    else
+        mm_mix_clock += mm_mix_update_ticks;
 }
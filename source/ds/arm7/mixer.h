@@ -17,9 +17,14 @@
 void mmMixerInit(void);
 void mmMixerMix(void);
 void mmMixerPre(void);
+void mmMixerMarkDirty(mm_word mask);
+void mmMixerSetRamp(int channel, mm_word rate);
 
 extern mm_byte mm_output_slice;
 extern mm_mode_enum mm_mixing_mode;
+extern mm_word mm_mix_update_ticks;
+extern mm_word mm_mix_clock;
+extern mm_word mm_mix_bus_mask;
 extern const mm_byte mmVolumeDivTable[];
 extern const mm_byte mmVolumeShiftTable[];
 extern mm_mix_data_ds mm_mix_data;
@@ -67,7 +67,7 @@
 
     .balign 4
 
-#define mix_data_len    8544    // yikes
+#define mix_data_len    1872    // size of the mode C data, the largest one
 
 mm_mix_data:
     .space mix_data_len
@@ -83,6 +83,12 @@ mm_mix_data:
 //**********************************************************
 .equ    MB_FETCH_SIZE,    (256)
 .equ    MB_FETCH_PADDING, (32)
+.equ    MB_FETCH_HISTORY, (4)           // word before the fetched data
+
+// interpolation kernels : mm_interpolation
+.equ    MM_INTERP_NEAREST, 0
+.equ    MM_INTERP_LINEAR,  1
+.equ    MM_INTERP_CUBIC,   2
 
 // structure
 .equ MB_SH_VLEVEL,   0                  // next volume level
@@ -93,8 +99,8 @@ mm_mix_data:
 .equ MB_SH_LEN,      MB_SH_RESERVED + 1
 
 // structure
-.equ MB_OUTPUT, 0                       // 512 bytes/channel (128 samples, double-buffered)
-.equ MB_FETCH,  MB_OUTPUT + (16 * 512)
+.equ MB_HISTORY, 0
+.equ MB_FETCH,   MB_HISTORY + MB_FETCH_HISTORY
 .equ MB_SHADOW, MB_FETCH + (MB_FETCH_SIZE + MB_FETCH_PADDING)
 .equ MB_LEN,    MB_SHADOW + (MB_SH_LEN * 16)
 
@@ -179,11 +185,13 @@ mmbResampleData:
     add     r1, r1, pos, lsr #10
 .endif
     bic     r1, #0b11
+    sub     r1, #MB_FETCH_HISTORY               // fetch the previous word too
     str     r1, [r0, #0]
 
     mov     r1, #DMA_ENABLE | DMA_32BIT         // set dma CNT
     add     r2, r2, #16384                      // add threshold for safety
     add     r1, r1, r2, lsr #10 + (2 - \shift)
+    add     r1, r1, #MB_FETCH_HISTORY / 4       // (history word)
     str     r1, [r0, #8]
 
     bl      \routine                                    // resample data
@@ -242,7 +250,8 @@ mmbResampleData:
 
     mov     dest, r0
 
-    mov     count, #128
+    ldr     count, =mm_mix_b_slice_len  // samples per slice
+    ldr     count, [count]
 
     cmp     r1, #0                  // if r1 then zero the first X samples (newnote)
     beq     1f                      //
@@ -311,6 +320,67 @@ mmb_8bit:
 .endm
 //-------------------------------------------------------------------------
 
+//-------------------------------------------------------------------------------
+.macro mb_cubic shift, exit
+//-------------------------------------------------------------------------------
+// 4-point cubic Hermite (Catmull-Rom) interpolation, for any rate. The samples
+// are read relative to the start of the fetch, so "src" isn't modified. The
+// coefficients are doubled to avoid fractions:
+//
+//   C1 = s1 - s-1
+//   C2 = 2 * s-1 - 5 * s0 + 4 * s1 - s2
+//   C3 = 3 * (s0 - s1) + s2 - s-1
+//   out = s0 + (((C3 * t + C2) * t + C1) * t) / 2
+
+1:
+.if \shift == 1
+    mov     ta, pos, lsr #MP_SAMPFRAC           // 1   get address of s0
+    add     ta, src, ta, lsl #1                 // 1
+    ldrsh   m2, [ta, #-2]                       // 3   m2 = s-1
+    ldrsh   m3, [ta]                            // 3   m3 = s0
+    ldrsh   m4, [ta, #2]                        // 3   m4 = s1
+    ldrsh   next, [ta, #4]                      // 3   next = s2
+.else
+    add     ta, src, pos, lsr #MP_SAMPFRAC      // 1   get address of s0
+    ldrsb   m2, [ta, #-1]                       // 3   m2 = s-1
+    ldrsb   m3, [ta]                            // 3   m3 = s0
+    ldrsb   m4, [ta, #1]                        // 3   m4 = s1
+    ldrsb   next, [ta, #2]                      // 3   next = s2
+    mov     m2, m2, lsl #8                      // 4   expand to 16 bits
+    mov     m3, m3, lsl #8                      //
+    mov     m4, m4, lsl #8                      //
+    mov     next, next, lsl #8                  //
+.endif
+    mov     tb, pos, lsl #32 - MP_SAMPFRAC      // 2   tb = t (position fraction)
+    mov     tb, tb, lsr #32 - MP_SAMPFRAC       //
+    sub     lr, m4, m2                          // 1   lr = C1
+    rsb     curr, next, m2, lsl #1              // 4   curr = C2
+    add     curr, curr, m4, lsl #2              //
+    sub     curr, curr, m3, lsl #2              //
+    sub     curr, curr, m3                      //
+    sub     ta, m3, m4                          // 4   ta = C3
+    add     ta, ta, ta, lsl #1                  //
+    add     ta, ta, next                        //
+    sub     ta, ta, m2                          //
+    mul     m2, ta, tb                          // 3   C3 * t
+    add     ta, curr, m2, asr #MP_SAMPFRAC      // 1   + C2
+    mul     m2, ta, tb                          // 3   * t
+    add     ta, lr, m2, asr #MP_SAMPFRAC        // 1   + C1
+    mul     m2, ta, tb                          // 3   * t
+    add     m1, m3, m2, asr #MP_SAMPFRAC + 1    // 1   / 2 + s0
+    mov     ta, m1, asr #31                     // 4   clamp to 16 bits
+    teq     ta, m1, asr #15                     //
+    eorne   m1, ta, #0x7F00                     //
+    eorne   m1, m1, #0xFF                       //
+    strh    m1, [dest], #2                      // 2   write sample
+    add     pos, pos, rate                      // 1   increment position
+    subs    count, #1                           // 1
+    bne     1b                                  // 3
+    b       \exit
+
+.endm
+//-------------------------------------------------------------------------------
+
 //***************************************************************************
 mmb_resamp_16bit:
 //***************************************************************************
@@ -324,6 +394,13 @@ mmb_resamp_16bit:
     add     src, src, m2, lsl #1            // add offset to fetch
     push    {m1, src}
 
+    ldr     m3, =mm_mix_b_kernel            // select interpolation kernel
+    ldrb    m3, [m3]
+    cmp     m3, #MM_INTERP_CUBIC
+    beq     mmb_resamp_16bit_cubic
+    cmp     m3, #MM_INTERP_NEAREST
+    beq     mmb_resamp_16bit_nearest
+
     cmp     rate, #1 << MP_SAMPFRAC         // use nearest resampling for rates > 32khz
     blt     mmb_resamp_16bit_linear
 //******************************************************************
@@ -429,6 +506,12 @@ _mb16n_exit:
     add     pos, pos, m2, lsl #MP_SAMPFRAC - 1  // add src difference
     pop     {src, r12, pc}                      // return
 
+//******************************************************************
+mmb_resamp_16bit_cubic:
+//******************************************************************
+
+    mb_cubic    1, _mb16n_exit
+
 //****************************************************************************
 mmb_resamp_8bit:
 //****************************************************************************
@@ -442,6 +525,13 @@ mmb_resamp_8bit:
     add     src, m2                             // add offset to fetch
     push    {m1, src}
 
+    ldr     m3, =mm_mix_b_kernel                // select interpolation kernel
+    ldrb    m3, [m3]
+    cmp     m3, #MM_INTERP_CUBIC
+    beq     mmb_resamp_8bit_cubic
+    cmp     m3, #MM_INTERP_NEAREST
+    beq     mmb_resamp_8bit_nearest
+
     cmp     rate, #1 << MP_SAMPFRAC             // use nearest resampling for rates >= 1.0
     blt     mmb_resamp_8bit_linear
 
@@ -551,6 +641,12 @@ mb8n_exit:
 
     pop     {src, r12, pc}                  // return
 
+//***********************************************************************************
+mmb_resamp_8bit_cubic:
+//***********************************************************************************
+
+    mb_cubic    0, mb8n_exit
+
 //*********************************************************
 mmbZerofillBuffer: // In: {r0 = buffer}
 //*********************************************************
@@ -562,7 +658,8 @@ mmbZerofillBuffer: // In: {r0 = buffer}
     // count, dest = r6, r10 (they have to be pushed)
     push    {count, dest, lr}
     mov     dest, r0
-    mov     count, #128
+    ldr     count, =mm_mix_b_slice_len
+    ldr     count, [count]
     mov     m1, #0
     mov     m2, #0
     mov     m3, #0
@@ -679,6 +776,18 @@ mmcMixChunk:
     ldrh    r1, [rch, #C_CVOL]              // r1 = vol: 0..2047
     lsr     r1, #5                          //
 
+    ldr     r2, =mm_mix_channels            // r2 = channel index
+    sub     r2, rch, r2                     //
+    lsr     r2, #4                          //
+    ldr     r3, =mm_mix_bus_mask            // r3 = bus of the channel
+    ldr     r3, [r3]                        //
+    mov     r3, r3, lsr r2                  //
+    and     r3, #1                          //
+    ldr     r2, =mm_bus_gain                // scale volume by bus gain
+    ldr     r2, [r2, r3, lsl #2]            //
+    mul     r3, r1, r2                      //
+    mov     r1, r3, lsr #8                  //
+
     mul     r9, r0, r1                      // calc right vol
     mov     r9, r9, lsr #10                 // 18->8 bit
     rsb     r0, r0, #128
@@ -6,12 +6,13 @@
 #ifndef MM_DS_ARM7_MIXER_TYPES_H__
 #define MM_DS_ARM7_MIXER_TYPES_H__
 
+#include <assert.h>
+
 #include <mm_types.h>
 
 #include "ds/arm7/main_ds7.h"
+#include "ds/common/mode_b.h"
 
-#define MM_MIX_B_NUM_SAMPLES 128
-#define MM_MIX_B_OUTPUT_CH_SIZE (128 * 4)
 #define MM_SW_BUFFERLEN 224 // [samples], note: nothing
 #define MM_SW_CHUNKLEN 112 // [samples]
 
@@ -27,8 +28,7 @@ mmshadow_b_ds;
 
 typedef struct t_mmixdatabds
 {
-    // 128 samples per channel, double-buffered
-    mm_byte output[NUM_PHYS_CHANNELS][MM_MIX_B_OUTPUT_CH_SIZE];
+    mm_byte history[4]; // Word before the fetched data, for cubic interpolation
     mm_byte fetch[256];
     mm_byte padding[32];
     mmshadow_b_ds shadow[NUM_PHYS_CHANNELS];
@@ -65,4 +65,7 @@ typedef union t_mmixdatads
 }
 mm_mix_data_ds;
 
+// Must match mix_data_len in mixer_asm.s
+static_assert(sizeof(mm_mix_data_ds) == 1872);
+
 #endif // MM_DS_ARM7_MIXER_TYPES_H__
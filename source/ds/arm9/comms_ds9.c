@@ -4,8 +4,11 @@
 // Copyright (c) 2023, Lorenzooone (lollo.lollo.rbiz@gmail.com)
 // Copyright (c) 2025, Antonio Niño Díaz (antonio_nd@outlook.com)
 
+#include <assert.h>
 #include <stddef.h>
 #include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include <nds.h>
 
@@ -16,6 +19,10 @@
 #include "core/effect.h"
 #include "ds/arm9/main_ds9.h"
 #include "ds/common/comm_messages.h"
+#include "ds/common/events.h"
+#include "ds/common/mode_b.h"
+#include "ds/common/ring.h"
+#include "ds/common/status.h"
 
 /***********************************************************************
  * Value32 format
@@ -33,11 +40,27 @@
  *
  * First byte: Length of data
  * Following bytes: data
+ *
+ * The data can contain several commands one after the other. The ARM7 doesn't
+ * need to know where each datamsg ends, it reads the commands one by one.
  ***********************************************************************/
 
 #define MAX_PARAM_WORDS         4
 #define NO_HANDLES_AVAILABLE    0
 
+// Maximum number of effect handles with pending volume, panning or rate changes
+// in a batch.
+#define BATCH_EFFECT_UPDATES    16
+
+#define BATCH_EFFECT_VOL        (1 << 0)
+#define BATCH_EFFECT_PAN        (1 << 1)
+#define BATCH_EFFECT_RATE       (1 << 2)
+
+#define COMMAND_RING_WORDS      256 // Must be a power of two
+
+// Size of a MSG_SCHEDULE message that contains the longest command
+#define SCHEDULE_MSG_WORDS      ((1 + 1 + 4 + 1 + MAX_SCHEDULED_COMMAND_SIZE + 3) / 4)
+
 // Flag used by the mmStreamBegin() and mmStreamEnd()
 volatile mm_byte mm_stream_arm9_flag;
 
@@ -52,13 +75,351 @@ static mm_byte mmActiveStatus; // Bit 0 = main layer. Bit 1 = sub layer (jingle)
 // too inaccurate to be useful.
 static mm_hword mmLayerMainPosition;
 
+// The ARM7 writes its CPU load here. It fills whole cache lines so that they
+// can be invalidated without affecting other variables.
+#define LOAD_BLOCK_SIZE 32
+
+static_assert(sizeof(mm_arm7_load) <= LOAD_BLOCK_SIZE);
+
+static union {
+    mm_arm7_load load;
+    mm_byte padding[LOAD_BLOCK_SIZE];
+} mmARM7LoadBlock __attribute__((aligned(LOAD_BLOCK_SIZE)));
+
+static bool mmARM7LoadEnabled;
+
+// The ARM7 publishes its status here after the first call to mmGetARM7Status().
+// It's only accessed through the uncached mirror of main RAM.
+#define STATUS_BLOCK_SIZE ((sizeof(mm_status_block) + 31) & ~31)
+
+static union {
+    mm_status_block block;
+    mm_byte padding[STATUS_BLOCK_SIZE];
+} mmStatusBlockMemory __attribute__((aligned(32)));
+
+static mm_status_block *mmStatusBlock;
+
+// Last handle returned by the ARM7 for each of its effect channels, and the
+// value of update_count in the status block when it was received. The effect is
+// started after the block is published, so the block only shows it once
+// update_count has increased.
+typedef struct
+{
+    mm_sfxhand  handle;
+    bool        known_count; // False if the block wasn't set up yet
+    mm_word     update_count;
+} mm_effect_start;
+
+static mm_effect_start mmEffectStart[EFFECT_CHANNELS];
+
+// The ARM7 writes song events here after the first call to mmPollEvents() or
+// mmReadEvent(). It's only accessed through the uncached mirror of main RAM.
+static union {
+    mm_ring ring;
+    mm_word padding[(sizeof(mm_ring) / sizeof(mm_word)) + EVENT_RING_WORDS];
+} mmEventRingMemory __attribute__((aligned(32)));
+
+static mm_ring *mmEventRing;
+
+// Commands sent between mmBeginBatch() and mmCommitBatch() are packed here.
+// The first byte is the length of the data, like in any other datamsg.
+static union {
+    mm_word words[MAX_DATAMSG_SIZE / sizeof(mm_word)];
+    mm_byte bytes[MAX_DATAMSG_SIZE];
+} mmBatch;
+
+static bool mmBatchActive;
+
+// Volume, panning and rate changes of sound effects in a batch. Only the last
+// value of each one is sent.
+typedef struct {
+    mm_sfxhand  handle;
+    mm_byte     flags;
+    mm_byte     volume;
+    mm_byte     panning;
+    mm_hword    rate;
+} mm_batch_effect_update;
+
+static mm_batch_effect_update mmBatchEffects[BATCH_EFFECT_UPDATES];
+static mm_word mmBatchEffectCount;
+
+// After mmEnableCommandRing() the datamsgs are written to this ring instead of
+// being sent through the FIFO. It's only accessed through the uncached mirror
+// of main RAM, and it fills whole cache lines so that they are never shared
+// with other variables.
+static union {
+    mm_ring ring;
+    mm_word padding[(sizeof(mm_ring) / sizeof(mm_word)) + COMMAND_RING_WORDS];
+} mmCommandRingMemory __attribute__((aligned(32)));
+
+static mm_ring *mmCommandRing;
+
+// Last configuration of mode B set with mmSetModeBConfig(), and the output
+// buffer allocated by the ARM9 for configurations that don't have one.
+static mm_mode_b_config mmModeBConfig = { 128, 2, NULL };
+static mm_addr mmModeBDefaultOutput;
+
+// After mmEnableAsyncEffects() the ARM9 allocates the handles of new effects in
+// its own effect channels, and it doesn't wait for the ARM7. A channel is only
+// used again after the ARM7 has reported that it's free.
+static bool mmAsyncEffects;
+static volatile mm_word mmAsyncBusy; // One bit per effect channel
+static mm_byte mmAsyncCounter[EFFECT_CHANNELS_ARM9];
+
+// Commands sent between mmBeginSchedule() and mmEndSchedule() are wrapped in a
+// MSG_SCHEDULE message with this mixer time.
+static bool mmScheduleActive;
+static mm_word mmScheduleTime;
+
+static void SendDatamsg(mm_word *values, int num_words)
+{
+    if (mmCommandRing != NULL)
+    {
+        // The ring only supports one producer, so interrupt handlers that
+        // send commands can't push while the main code is pushing. Interrupts
+        // are enabled again between attempts so that the wait doesn't block
+        // them. The ARM7 empties the ring at every mixer update, so it can't
+        // stay full for long.
+        while (1)
+        {
+            int oldIME = enterCriticalSection();
+            mm_bool pushed = mmRingPush(mmCommandRing, values, num_words);
+            leaveCriticalSection(oldIME);
+
+            if (pushed)
+                return;
+        }
+    }
+
+    fifoSendDatamsg(mmFifoChannel, num_words * sizeof(mm_word), (unsigned char*)values);
+}
+
+// Send the address of a block of shared memory to the ARM7. These messages
+// always go through the FIFO right away, even inside a batch or a schedule, so
+// that the ARM7 starts using the block before any later command. The ARM7
+// handles all messages in the FIFO before looking at the command ring, so
+// nothing is reordered.
+static void SendSharedAddress(mm_word id, mm_word address)
+{
+    mm_word buffer[MAX_PARAM_WORDS];
+
+    buffer[0] = (address << 16) | (id << 8) | 5;
+    buffer[1] = address >> 16;
+
+    fifoSendDatamsg(mmFifoChannel, 2 * sizeof(mm_word), (unsigned char*)buffer);
+}
+
+static void mmBatchFlush(void)
+{
+    if (mmBatch.bytes[0] == 0)
+        return;
+
+    mm_word num_words = (mmBatch.bytes[0] + 1 + 3) / sizeof(mm_word);
+
+    SendDatamsg(mmBatch.words, num_words);
+
+    mmBatch.bytes[0] = 0;
+}
+
+// Add a command to the batch. The first byte of the values is the length of the
+// command, it's followed by the command.
+static void mmBatchAppend(mm_word *values)
+{
+    mm_byte *command = (mm_byte *)values;
+    mm_word length = command[0];
+
+    if (mmBatch.bytes[0] + length > MAX_DATAMSG_SIZE - 1)
+        mmBatchFlush();
+
+    mm_byte *dest = &mmBatch.bytes[1 + mmBatch.bytes[0]];
+
+    for (mm_word i = 0; i < length; i++)
+        dest[i] = command[1 + i];
+
+    mmBatch.bytes[0] += length;
+}
+
+// Wrap a command in a MSG_SCHEDULE message. The first byte of the values is the
+// length of the command, it's followed by the command. It returns the number of
+// words of the new message.
+static int mmScheduleWrap(mm_word *values, mm_byte *message)
+{
+    mm_byte *command = (mm_byte *)values;
+    mm_word length = command[0];
+
+    if (length > MAX_SCHEDULED_COMMAND_SIZE)
+        libndsCrash("Maxmod: Command too long to schedule");
+
+    message[0] = 1 + 4 + 1 + length;
+    message[1] = MSG_SCHEDULE;
+    message[2] = mmScheduleTime;
+    message[3] = mmScheduleTime >> 8;
+    message[4] = mmScheduleTime >> 16;
+    message[5] = mmScheduleTime >> 24;
+    message[6] = length;
+
+    for (mm_word i = 0; i < length; i++)
+        message[7 + i] = command[1 + i];
+
+    return (message[0] + 1 + 3) / sizeof(mm_word);
+}
+
 // Send data via Datamsg
 static void SendString(mm_word* values, int num_words)
 {
     if (mmFifoChannel == -1)
         libndsCrash("Maxmod not initialized");
 
-    fifoSendDatamsg(mmFifoChannel, num_words * sizeof(mm_word), (unsigned char*)values);
+    union {
+        mm_word words[SCHEDULE_MSG_WORDS];
+        mm_byte bytes[SCHEDULE_MSG_WORDS * sizeof(mm_word)];
+    } scheduled;
+
+    if (mmScheduleActive)
+    {
+        num_words = mmScheduleWrap(values, scheduled.bytes);
+        values = scheduled.words;
+    }
+
+    if (mmBatchActive)
+    {
+        mmBatchAppend(values);
+        return;
+    }
+
+    SendDatamsg(values, num_words);
+}
+
+// Add the pending changes of an effect update to the batch
+static void mmBatchEmitEffect(mm_batch_effect_update *update)
+{
+    mm_word buffer[MAX_PARAM_WORDS];
+
+    if (update->flags & BATCH_EFFECT_VOL)
+    {
+        buffer[0] = (update->handle << 16) | (MSG_EFFECTVOL << 8) | 4;
+        buffer[1] = update->volume;
+        mmBatchAppend(buffer);
+    }
+
+    if (update->flags & BATCH_EFFECT_PAN)
+    {
+        buffer[0] = (update->handle << 16) | (MSG_EFFECTPAN << 8) | 4;
+        buffer[1] = update->panning;
+        mmBatchAppend(buffer);
+    }
+
+    if (update->flags & BATCH_EFFECT_RATE)
+    {
+        buffer[0] = (update->handle << 16) | (MSG_EFFECTRATE << 8) | 5;
+        buffer[1] = update->rate;
+        mmBatchAppend(buffer);
+    }
+
+    update->flags = 0;
+}
+
+static void mmBatchEmitAllEffects(void)
+{
+    for (mm_word i = 0; i < mmBatchEffectCount; i++)
+        mmBatchEmitEffect(&mmBatchEffects[i]);
+
+    mmBatchEffectCount = 0;
+}
+
+// Commands that aren't coalesced must be sent after the pending changes of the
+// same handle so that the ARM7 sees them in the right order.
+static void mmBatchEmitHandle(mm_sfxhand handle)
+{
+    if (!mmBatchActive)
+        return;
+
+    for (mm_word i = 0; i < mmBatchEffectCount; i++)
+    {
+        if (mmBatchEffects[i].handle == handle)
+            mmBatchEmitEffect(&mmBatchEffects[i]);
+    }
+}
+
+// Returns the pending update of a handle, or NULL if the changes must be sent
+// right away because there isn't a batch. Scheduled changes are never
+// coalesced, they must keep their own time.
+static mm_batch_effect_update *mmBatchGetEffect(mm_sfxhand handle)
+{
+    if (!mmBatchActive || mmScheduleActive)
+        return NULL;
+
+    for (mm_word i = 0; i < mmBatchEffectCount; i++)
+    {
+        if (mmBatchEffects[i].handle == handle)
+            return &mmBatchEffects[i];
+    }
+
+    if (mmBatchEffectCount == BATCH_EFFECT_UPDATES)
+        mmBatchEmitAllEffects();
+
+    mm_batch_effect_update *update = &mmBatchEffects[mmBatchEffectCount++];
+
+    update->handle = handle;
+    update->flags = 0;
+
+    return update;
+}
+
+// Send commands through a ring in main RAM instead of the FIFO
+void mmEnableCommandRing(void)
+{
+    if (mmCommandRing != NULL)
+        return;
+
+    if (mmFifoChannel == -1)
+        libndsCrash("Maxmod not initialized");
+
+    // Commands that are waiting in the batch must arrive before the ring is
+    // used for the first time.
+    mmBatchFlush();
+
+    // Make sure that no cache line of the ring is written back to RAM later,
+    // after it has started to be used through the uncached mirror.
+    DC_FlushRange(&mmCommandRingMemory, sizeof(mmCommandRingMemory));
+
+    mm_ring *ring = memUncached(&mmCommandRingMemory);
+    mmRingInit(ring, COMMAND_RING_WORDS);
+
+    SendSharedAddress(MSG_COMMANDRING, (mm_word)&mmCommandRingMemory.ring);
+
+    mmCommandRing = ring;
+}
+
+// Make the ARM7 run the following commands at the given mixer time
+void mmBeginSchedule(mm_word time)
+{
+    mmScheduleTime = time;
+    mmScheduleActive = true;
+}
+
+// Make the ARM7 run the following commands as soon as possible
+void mmEndSchedule(void)
+{
+    mmScheduleActive = false;
+}
+
+// Start packing commands together
+void mmBeginBatch(void)
+{
+    mmBatchActive = true;
+}
+
+// Send all commands packed since mmBeginBatch()
+void mmCommitBatch(void)
+{
+    if (!mmBatchActive)
+        return;
+
+    mmBatchEmitAllEffects();
+    mmBatchFlush();
+
+    mmBatchActive = false;
 }
 
 static void SendCommand(mm_word id)
@@ -238,56 +599,293 @@ void mmSetEffectsVolume(mm_word vol)
 }
 
 // Open audio stream
-void mmStreamBegin(mm_word wave_memory, mm_hword clks, mm_hword len, mm_byte format)
+void mmStreamBegin(mm_word id, mm_word wave_memory, mm_hword clks, mm_hword len,
+                   mm_byte format)
 {
     mm_stream_arm9_flag = 0;
 
     mm_word buffer[MAX_PARAM_WORDS];
 
-    buffer[0] = (((mm_word)wave_memory) << 16) | (MSG_OPENSTREAM << 8) | (10);
+    buffer[0] = (((mm_word)wave_memory) << 16) | (MSG_OPENSTREAM << 8) | (11);
     buffer[1] = (((mm_word)wave_memory) >> 16) | (clks << 16);
-    buffer[2] = len | (format << 16);
+    buffer[2] = len | (format << 16) | (id << 24);
 
     SendString(buffer, 3);
 
+    // The ARM7 must receive the command before waiting for its answer
+    mmBatchFlush();
+
     while (mm_stream_arm9_flag == 0);
 }
 
 // Close audio stream
-void mmStreamEnd(void)
+void mmStreamEnd(mm_word id)
 {
     mm_stream_arm9_flag = 0;
 
-    SendCommand(MSG_CLOSESTREAM);
+    SendCommandByte(MSG_CLOSESTREAM, id);
+
+    mmBatchFlush();
 
     while (mm_stream_arm9_flag == 0);
 }
 
+void mmStreamVolumeEx(mm_word id, mm_byte volume)
+{
+    SendCommandByteByte(MSG_STREAMVOL, volume, id);
+}
+
 void mmStreamVolume(mm_byte volume)
 {
-    SendCommandByte(MSG_STREAMVOL, volume);
+    mmStreamVolumeEx(0, volume);
+}
+
+static void SendModeBConfig(const mm_mode_b_config *config, mm_addr output_addr)
+{
+    mm_word output = (mm_word)output_addr;
+    mm_word buffer[MAX_PARAM_WORDS];
+
+    buffer[0] = (config->slice_length << 16) | (MSG_MODEBCONFIG << 8) | 9;
+    buffer[1] = config->slice_count | (output << 16);
+    buffer[2] = output >> 16;
+
+    SendString(buffer, 3);
+}
+
+// Allocate the default output buffer of mode B the first time that it's
+// needed, and send it to the ARM7. The ARM7 writes to it, so it's flushed once
+// and the ARM9 doesn't access it again. It's never freed because the ARM9 can't
+// know when the ARM7 has stopped using it.
+static void mmSetupModeBOutput(void)
+{
+    if ((mmModeBConfig.output != NULL) || (mmModeBDefaultOutput != NULL))
+        return;
+
+    size_t size = MM_MODE_B_DEFAULT_SIZE;
+
+    // Align it to cache lines so that they aren't shared with other variables
+    mm_addr output = aligned_alloc(32, size);
+    if (output == NULL)
+        return; // The ARM7 will use mode A
+
+    memset(output, 0, size);
+    DC_FlushRange(output, size);
+
+    mmModeBDefaultOutput = output;
+
+    SendModeBConfig(&mmModeBConfig, output);
 }
 
 // Select audio mode
 void mmSelectMode(mm_mode_enum mode)
 {
+    if (mode == MM_MODE_B)
+        mmSetupModeBOutput();
+
     SendCommandByte(MSG_SELECTMODE, mode);
 }
 
+// Set module volume and panning ramp rate
+void mmSetModuleRamp(mm_word rate, mm_bool instant_attack)
+{
+    SendCommandHwordByte(MSG_MODULERAMP, rate, instant_attack);
+}
+
+// Get the CPU usage of Maxmod in the ARM7
+void mmGetARM7Load(mm_arm7_load *load)
+{
+    if (!mmARM7LoadEnabled)
+    {
+        // The ARM7 doesn't measure anything until it's asked to
+        mmARM7LoadEnabled = true;
+
+        for (int i = 0; i < LOAD_BLOCK_SIZE; i++)
+            mmARM7LoadBlock.padding[i] = 0;
+
+        DC_FlushRange(&mmARM7LoadBlock, LOAD_BLOCK_SIZE);
+
+        SendSharedAddress(MSG_LOADBLOCK, (mm_word)&mmARM7LoadBlock);
+    }
+
+    DC_InvalidateRange(&mmARM7LoadBlock, LOAD_BLOCK_SIZE);
+
+    *load = mmARM7LoadBlock.load;
+}
+
+// Select audio mode without stopping the audio
+void mmSelectModeLive(mm_mode_enum mode)
+{
+    if (mode == MM_MODE_B)
+        mmSetupModeBOutput();
+
+    SendCommandByte(MSG_SELECTMODELIVE, mode);
+}
+
+// Configure mode B slices
+mm_bool mmSetModeBConfig(const mm_mode_b_config *config)
+{
+    mm_mode_b_config def = { 128, 2, NULL };
+
+    if (config == NULL)
+        config = &def;
+    else if (!mmModeBConfigIsValid(config))
+        return false;
+
+    mmModeBConfig = *config;
+
+    // If the default buffer hasn't been allocated yet, it's sent when mode B
+    // is selected.
+    mm_addr output = config->output;
+    if (output == NULL)
+        output = mmModeBDefaultOutput;
+
+    SendModeBConfig(config, output);
+
+    return true;
+}
+
+// Set mode C hardware and software channels
+mm_bool mmSetModeCVoices(mm_word hardware, mm_word software)
+{
+    if ((hardware > MM_MODE_C_HW_VOICES_MAX) || (software > MM_MODE_C_SW_VOICES_MAX))
+        return false;
+
+    SendCommandByteByte(MSG_MODECVOICES, hardware, software);
+
+    return true;
+}
+
+// Set mode C software mixing budget
+void mmSetModeCBudget(mm_word cycles)
+{
+    mm_word buffer[MAX_PARAM_WORDS];
+
+    buffer[0] = (cycles << 16) | (MSG_MODECBUDGET << 8) | 5;
+    buffer[1] = cycles >> 16;
+
+    SendString(buffer, 2);
+}
+
+// Select mode B interpolation
+void mmSetInterpolation(mm_interpolation kernel)
+{
+    SendCommandByte(MSG_INTERPOLATION, kernel);
+}
+
 static mm_sfxhand mmWaitForHandle(void)
 {
+    // The ARM7 must receive the command before waiting for its answer
+    mmBatchFlush();
+
     // The address handler is (mis)used to send and receive SFX handlers without
     // needing an additional FIFO channel.
     fifoWaitAddressAsync(mmFifoChannel);
 
     mm_sfxhand handle = ((mm_word)fifoGetAddress(mmFifoChannel)) & 0xFFFF;
 
+    mm_word sfx_channel = (handle & 0xFF) - 1;
+    if (sfx_channel < EFFECT_CHANNELS)
+    {
+        mm_effect_start *start = &mmEffectStart[sfx_channel];
+
+        start->handle = handle;
+        start->known_count = mmStatusBlock != NULL;
+        if (start->known_count)
+            start->update_count = ((volatile mm_status_block *)mmStatusBlock)->status.update_count;
+    }
+
+    return handle;
+}
+
+// Allocate a handle in an effect channel of the ARM9. If the old handle still
+// owns its channel the channel is reused with a new handle.
+static mm_sfxhand mmAsyncAllocHandle(mm_sfxhand old_handle)
+{
+    int oldIME = enterCriticalSection();
+
+    mm_word slot = (old_handle & 0xFF) - 1 - EFFECT_CHANNELS;
+
+    if ((slot >= EFFECT_CHANNELS_ARM9) || ((mmAsyncBusy & BIT(slot)) == 0) ||
+        (mmAsyncCounter[slot] != (old_handle >> 8)))
+    {
+        for (slot = 0; slot < EFFECT_CHANNELS_ARM9; slot++)
+        {
+            if ((mmAsyncBusy & BIT(slot)) == 0)
+                break;
+        }
+
+        if (slot == EFFECT_CHANNELS_ARM9)
+        {
+            leaveCriticalSection(oldIME);
+            return MM_SFXHAND_INVALID;
+        }
+    }
+
+    mmAsyncBusy |= BIT(slot);
+    mmAsyncCounter[slot]++;
+
+    mm_sfxhand handle = (mmAsyncCounter[slot] << 8) | (EFFECT_CHANNELS + slot + 1);
+
+    leaveCriticalSection(oldIME);
+
+    return handle;
+}
+
+// Called from the FIFO handler when the ARM7 has freed an effect channel
+static void mmAsyncFreeHandle(mm_sfxhand handle)
+{
+    mm_word slot = (handle & 0xFF) - 1 - EFFECT_CHANNELS;
+
+    if (slot >= EFFECT_CHANNELS_ARM9)
+        return;
+
+    // Ignore reports of handles that have already been replaced
+    if (mmAsyncCounter[slot] == (handle >> 8))
+        mmAsyncBusy &= ~BIT(slot);
+}
+
+static mm_sfxhand mmAsyncEffectEx(mm_sound_effect *sound)
+{
+    mm_sfxhand handle = mmAsyncAllocHandle(sound->handle);
+    if (handle == MM_SFXHAND_INVALID)
+        return MM_SFXHAND_INVALID;
+
+    mm_word buffer[MAX_PARAM_WORDS];
+
+    buffer[0] = (((mm_word)sound->sample) << 16) | (MSG_EFFECTEXHANDLE << 8) | (13);
+    buffer[1] = (sound->rate << 16) | (((mm_word)sound->sample) >> 16);
+    buffer[2] = (handle << 16) | (sound->handle & 0xFFFF);
+    buffer[3] = (sound->panning << 8) | sound->volume;
+
+    SendString(buffer, 4);
+
     return handle;
 }
 
+// Allocate effect handles in the ARM9
+void mmEnableAsyncEffects(void)
+{
+    mmAsyncEffects = true;
+}
+
 // Play sound effect, default parameters
 mm_sfxhand mmEffect(mm_word sample_ID)
 {
+    // Scheduled effects can't wait for the ARM7 to return a handle
+    if (mmAsyncEffects || mmScheduleActive)
+    {
+        mm_sound_effect sound =
+        {
+            .id = sample_ID,
+            .rate = 1024,
+            .handle = 0,
+            .volume = 255,
+            .panning = 128
+        };
+
+        return mmAsyncEffectEx(&sound);
+    }
+
     SendCommandHword(MSG_EFFECT, sample_ID);
 
     return mmWaitForHandle();
@@ -297,18 +895,42 @@ mm_sfxhand mmEffect(mm_word sample_ID)
 // volume should be a byte... :/
 void mmEffectVolume(mm_sfxhand handle, mm_word volume)
 {
+    mm_batch_effect_update *update = mmBatchGetEffect(handle);
+    if (update != NULL)
+    {
+        update->volume = volume;
+        update->flags |= BATCH_EFFECT_VOL;
+        return;
+    }
+
     SendCommandHwordByte(MSG_EFFECTVOL, handle, volume);
 }
 
 // Set effect panning
 void mmEffectPanning(mm_sfxhand handle, mm_byte panning)
 {
+    mm_batch_effect_update *update = mmBatchGetEffect(handle);
+    if (update != NULL)
+    {
+        update->panning = panning;
+        update->flags |= BATCH_EFFECT_PAN;
+        return;
+    }
+
     SendCommandHwordByte(MSG_EFFECTPAN, handle, panning);
 }
 
 // Set effect playback rate
 void mmEffectRate(mm_sfxhand handle, mm_word rate)
 {
+    mm_batch_effect_update *update = mmBatchGetEffect(handle);
+    if (update != NULL)
+    {
+        update->rate = rate;
+        update->flags |= BATCH_EFFECT_RATE;
+        return;
+    }
+
     mm_word buffer[MAX_PARAM_WORDS];
 
     buffer[0] = (handle << 16) | (MSG_EFFECTRATE << 8) | (5);
@@ -317,9 +939,24 @@ void mmEffectRate(mm_sfxhand handle, mm_word rate)
     SendString(buffer, 2);
 }
 
+// Set effect volume and panning ramp rate
+void mmEffectRamp(mm_sfxhand handle, mm_word rate)
+{
+    mmBatchEmitHandle(handle);
+
+    mm_word buffer[MAX_PARAM_WORDS];
+
+    buffer[0] = (handle << 16) | (MSG_EFFECTRAMP << 8) | (5);
+    buffer[1] = rate;
+
+    SendString(buffer, 2);
+}
+
 // Scale effect playback rate by some factor
 void mmEffectScaleRate(mm_sfxhand handle, mm_word factor)
 {
+    mmBatchEmitHandle(handle);
+
     mm_word buffer[MAX_PARAM_WORDS];
 
     buffer[0] = (handle << 16) | (MSG_EFFECTMULRATE << 8) | (5);
@@ -331,6 +968,8 @@ void mmEffectScaleRate(mm_sfxhand handle, mm_word factor)
 // Release sound effect
 void mmEffectRelease(mm_sfxhand handle)
 {
+    mmBatchEmitHandle(handle);
+
     mm_word buffer[MAX_PARAM_WORDS];
 
     buffer[0] = (handle << 24) | (1 << 16) | (MSG_EFFECTOPT << 8) | (4);
@@ -342,6 +981,8 @@ void mmEffectRelease(mm_sfxhand handle)
 // Stop sound effect
 void mmEffectCancel(mm_sfxhand handle)
 {
+    mmBatchEmitHandle(handle);
+
     mm_word buffer[MAX_PARAM_WORDS];
 
     buffer[0] = (handle << 24) | (0 << 16) | (MSG_EFFECTOPT << 8) | (4);
@@ -353,6 +994,11 @@ void mmEffectCancel(mm_sfxhand handle)
 // Play sound effect, parameters supplied
 mm_sfxhand mmEffectEx(mm_sound_effect *sound)
 {
+    mmBatchEmitHandle(sound->handle);
+
+    if (mmAsyncEffects || mmScheduleActive)
+        return mmAsyncEffectEx(sound);
+
     mm_word buffer[MAX_PARAM_WORDS];
 
     buffer[0] = (((mm_word)sound->sample) << 16) | (MSG_EFFECTEX << 8) | (11);
@@ -404,22 +1050,172 @@ void mmReverbStop(mm_reverbch channels)
 // Cancel all sound effects
 void mmEffectCancelAll(void)
 {
+    if (mmBatchActive)
+        mmBatchEmitAllEffects();
+
     SendCommand(MSG_EFFECTCANCELALL);
 }
 
-// Returns nonzero if module is playing
+// Set mix bus volume
+void mmSetBusVolume(mm_bus bus, mm_word volume)
+{
+    SendCommandHwordByte(MSG_BUSVOL, volume, bus);
+}
+
+// Configure music ducking
+void mmSetMusicDucking(mm_word level, mm_word attack, mm_word release)
+{
+    mm_word buffer[MAX_PARAM_WORDS];
+
+    buffer[0] = (level << 16) | (MSG_DUCKING << 8) | 7;
+    buffer[1] = (attack & 0xFFFF) | (release << 16);
+
+    SendString(buffer, 2);
+}
+
+// Copy the status published by the ARM7. It returns false if the ARM7 hasn't
+// published anything yet.
+static bool mmReadStatus(mm_arm7_status *status, mm_sfxhand *effects)
+{
+    if (mmStatusBlock == NULL)
+    {
+        for (size_t i = 0; i < STATUS_BLOCK_SIZE; i++)
+            mmStatusBlockMemory.padding[i] = 0;
+
+        // Make sure that no cache line of the block is written back to RAM
+        // later, after it has started to be used through the uncached mirror.
+        DC_FlushRange(&mmStatusBlockMemory, STATUS_BLOCK_SIZE);
+
+        SendSharedAddress(MSG_STATUSBLOCK, (mm_word)&mmStatusBlockMemory.block);
+
+        mmStatusBlock = memUncached(&mmStatusBlockMemory.block);
+    }
+
+    mm_status_block *block = mmStatusBlock;
+
+    while (1)
+    {
+        mm_word sequence = block->sequence;
+
+        if (sequence == 0)
+            return false;
+
+        // The ARM7 is writing the block right now
+        if (sequence & 1)
+            continue;
+
+        mmStatusBarrier();
+
+        if (status != NULL)
+            *status = block->status;
+
+        if (effects != NULL)
+        {
+            for (int i = 0; i < EFFECT_CHANNELS_TOTAL; i++)
+                effects[i] = block->effects[i];
+        }
+
+        mmStatusBarrier();
+
+        if (block->sequence == sequence)
+            return true;
+    }
+}
+
+// Get the state of the ARM7
+mm_bool mmGetARM7Status(mm_arm7_status *status)
+{
+    return mmReadStatus(status, NULL);
+}
+
+// Returns true if the handle is still playing an effect
+mm_bool mmEffectActive(mm_sfxhand handle)
+{
+    mm_word sfx_channel = (handle & 0xFF) - 1;
+
+    if (sfx_channel >= EFFECT_CHANNELS_TOTAL)
+        return false;
+
+    // The ARM9 knows the state of the handles it has allocated
+    if (sfx_channel >= EFFECT_CHANNELS)
+    {
+        mm_word slot = sfx_channel - EFFECT_CHANNELS;
+
+        return (mmAsyncBusy & BIT(slot)) && (mmAsyncCounter[slot] == (handle >> 8));
+    }
+
+    mm_effect_start *start = &mmEffectStart[sfx_channel];
+
+    mm_arm7_status status;
+    mm_sfxhand effects[EFFECT_CHANNELS_TOTAL];
+
+    // Until the block is published, assume that the last started effect is
+    // still playing.
+    if (!mmReadStatus(&status, effects))
+        return start->handle == handle;
+
+    if (effects[sfx_channel] == handle)
+        return true;
+
+    // The block may have been published before the effect was started. If the
+    // block wasn't set up when it was started, the first published block
+    // already includes it.
+    if ((start->handle == handle) && start->known_count)
+        return (mm_sword)(status.update_count - start->update_count) <= 0;
+
+    return false;
+}
+
+// Returns true if the status block has been published. Until then the values
+// received with MSG_ARM7_UPDATE are used.
+static bool mmReadStatusIfEnabled(mm_arm7_status *status)
+{
+    if (mmStatusBlock == NULL)
+        return false;
+
+    return mmReadStatus(status, NULL);
+}
+
 mm_bool mmActive(void)
 {
+    mm_arm7_status status;
+
+    if (mmReadStatusIfEnabled(&status))
+        return status.main.playing;
+
     return (mmActiveStatus >> 0) & 1;
 }
 
 mm_bool mmJingleActive(void)
 {
+    mm_arm7_status status;
+
+    if (mmReadStatusIfEnabled(&status))
+        return status.jingle.playing;
+
     return (mmActiveStatus >> 1) & 1;
 }
 
+mm_word mmGetPositionTick(void)
+{
+    mm_arm7_status status;
+
+    if (!mmReadStatus(&status, NULL))
+        return 0;
+
+    if (!status.main.playing)
+        return 0;
+
+    return status.main.tick;
+}
+
 mm_word mmGetPositionRow(void)
 {
+    mm_arm7_status status;
+
+    if (mmReadStatusIfEnabled(&status))
+        return status.main.playing ? status.main.row : 0;
+
     if (mmActive() == 0)
         return 0;
 
@@ -428,12 +1224,71 @@ mm_word mmGetPositionRow(void)
 
 mm_word mmGetPosition(void)
 {
+    mm_arm7_status status;
+
+    if (mmReadStatusIfEnabled(&status))
+        return status.main.playing ? status.main.position : 0;
+
     if (mmActive() == 0)
         return 0;
 
     return mmLayerMainPosition & 0xFF;
 }
 
+// Ask the ARM7 to write song events to the event ring
+static void mmSetupEventRing(void)
+{
+    // Make sure that no cache line of the ring is written back to RAM later,
+    // after it has started to be used through the uncached mirror.
+    DC_FlushRange(&mmEventRingMemory, sizeof(mmEventRingMemory));
+
+    mm_ring *ring = memUncached(&mmEventRingMemory);
+    mmRingInit(ring, EVENT_RING_WORDS);
+
+    SendSharedAddress(MSG_EVENTRING, (mm_word)&mmEventRingMemory.ring);
+
+    mmEventRing = ring;
+}
+
+// Remove the oldest song event from the event ring
+mm_bool mmReadEvent(mm_song_event *event)
+{
+    if (mmEventRing == NULL)
+        mmSetupEventRing();
+
+    mm_word record[EVENT_RECORD_WORDS];
+
+    if (!mmRingPop(mmEventRing, record, EVENT_RECORD_WORDS))
+        return false;
+
+    event->msg = record[0] & 0xFF;
+    event->param = (record[0] >> 8) & 0xFF;
+    event->layer = (record[0] >> 16) & 0xFF;
+    event->tick = record[1] & 0xFF;
+    event->row = (record[1] >> 8) & 0xFF;
+    event->position = (record[1] >> 16) & 0xFF;
+    event->time = record[2];
+
+    return true;
+}
+
+// Call the event handler for all events in the event ring
+mm_word mmPollEvents(void)
+{
+    mm_word count = 0;
+    mm_song_event event;
+
+    while (mmReadEvent(&event))
+    {
+        if (mmCallback != NULL)
+            mmCallback(event.msg, event.param);
+
+        count++;
+    }
+
+    return count;
+}
+
 // Default maxmod message receiving code
 static void mmReceiveMessageValue32(uint32_t value32, void *userdata)
 {
@@ -450,6 +1305,10 @@ static void mmReceiveMessageValue32(uint32_t value32, void *userdata)
     {
         mm_stream_arm9_flag = 1;
     }
+    else if (cmd == MSG_ARM7_SFX_FREED)
+    {
+        mmAsyncFreeHandle(value32 & 0xFFFF);
+    }
     else if (cmd == MSG_ARM7_UPDATE)
     {
         mmLayerMainPosition = value32 & 0xFFFF;
@@ -0,0 +1,412 @@
+// SPDX-License-Identifier: ISC
+//
+// Copyright (c) 2026, Antonio Niño Díaz (antonio_nd@outlook.com)
+
+// ARM9 software mixer. It mixes sound effects on the ARM9 and outputs the
+// result through the audio stream, so that they don't use any hardware channel
+// or ARM7 CPU time.
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <nds.h>
+
+#include <maxmod9.h>
+#include <mm_mas.h>
+#include <mm_types.h>
+
+#include "ds/arm9/main_ds9.h"
+
+#define BASE_SAMPLE_ADDRESS 0x2000000
+
+typedef struct
+{
+    const void *data;           // Sample data. NULL if the voice is free
+    mm_word     end;            // End of the sample (in samples)
+    mm_word     loop_length;    // Length of the loop (in samples). 0 = no loop
+    mm_word     position;       // Integer part of the read position
+    mm_word     fraction;       // Fractional part of the read position (16 bits)
+    mm_word     step;           // 16.16 increment of the read position
+    mm_hword    base_rate;      // Center rate of the sample (Hz * 1024 / 32768)
+    mm_byte     format;         // MM_SFORMAT_8BIT or MM_SFORMAT_16BIT
+    mm_byte     counter;        // Upper byte of the handle of this voice
+    mm_byte     volume;
+    mm_byte     panning;
+} mm_soft_voice;
+
+static mm_soft_voice mm_soft_voices[MM_SOFT_VOICES];
+
+static mm_byte mm_soft_counter;
+
+static mm_bool mm_soft_active;
+static mm_word mm_soft_stream;       // Index of the stream used for the output
+static mm_word mm_soft_rate;         // Output rate in Hz
+
+static mm_sword *mm_soft_mix_buffer; // Interleaved stereo accumulator
+static mm_word mm_soft_mix_length;   // Size of the accumulator in samples
+
+// Returns the voice that belongs to a handle, or NULL if the handle isn't
+// valid anymore.
+static mm_soft_voice *mmSoftGetVoice(mm_sfxhand handle)
+{
+    mm_word index = (handle & 0xFF) - 1;
+
+    if (index >= MM_SOFT_VOICES)
+        return NULL;
+
+    mm_soft_voice *voice = &mm_soft_voices[index];
+
+    if ((voice->data == NULL) || (voice->counter != (handle >> 8)))
+        return NULL;
+
+    return voice;
+}
+
+static mm_word mmSoftCalcStep(mm_word base_rate, mm_word rate)
+{
+    // Sample rate in Hz = base_rate * 32 * rate / 1024
+    return (mm_word)((((uint64_t)base_rate * rate) << 11) / mm_soft_rate);
+}
+
+static inline mm_sword mmSoftRead(const mm_soft_voice *voice, mm_word position)
+{
+    if (voice->format == MM_SFORMAT_8BIT)
+        return ((const int8_t *)voice->data)[position] << 8;
+    else
+        return ((const int16_t *)voice->data)[position];
+}
+
+// Adds "length" output samples of a voice to the accumulator. The voice is
+// freed when it reaches the end of a sample that doesn't loop.
+static void mmSoftMixVoice(mm_soft_voice *voice, mm_sword *mix, mm_word length)
+{
+    mm_sword gain_left = (voice->volume * (256 - voice->panning)) >> 8;
+    mm_sword gain_right = (voice->volume * (voice->panning + 1)) >> 8;
+
+    mm_word position = voice->position;
+    mm_word fraction = voice->fraction;
+    mm_word step = voice->step;
+    mm_word end = voice->end;
+    mm_word loop_length = voice->loop_length;
+
+    for (mm_word i = 0; i < length; i++)
+    {
+        if (position >= end)
+        {
+            if (loop_length == 0)
+            {
+                voice->data = NULL;
+                return;
+            }
+
+            while (position >= end)
+                position -= loop_length;
+        }
+
+        mm_word next = position + 1;
+        if (next >= end)
+            next = (loop_length == 0) ? position : next - loop_length;
+
+        // Linear interpolation. Only use 12 bits of the fraction so that the
+        // product can't overflow.
+        mm_sword s0 = mmSoftRead(voice, position);
+        mm_sword s1 = mmSoftRead(voice, next);
+        mm_sword sample = s0 + (((s1 - s0) * (mm_sword)(fraction >> 4)) >> 12);
+
+        mix[0] += sample * gain_left;
+        mix[1] += sample * gain_right;
+        mix += 2;
+
+        fraction += step;
+        position += fraction >> 16;
+        fraction &= 0xFFFF;
+    }
+
+    voice->position = position;
+    voice->fraction = fraction;
+}
+
+static inline int16_t mmSoftClamp(mm_sword sample)
+{
+    if (sample > 32767)
+        return 32767;
+    else if (sample < -32768)
+        return -32768;
+
+    return sample;
+}
+
+// Stream callback. It runs from the timer interrupt, so the voices can't be
+// modified by the rest of the code while it runs. The result is written
+// directly to the left and right planes of the stream buffer.
+static mm_word mmSoftMixCallback(mm_word length, const mm_stream_planes *planes,
+                                 mm_stream_formats format)
+{
+    (void)format;
+
+    if (length > mm_soft_mix_length)
+        length = mm_soft_mix_length;
+
+    mm_sword *mix = mm_soft_mix_buffer;
+    memset(mix, 0, length * 2 * sizeof(mm_sword));
+
+    for (int i = 0; i < MM_SOFT_VOICES; i++)
+    {
+        mm_soft_voice *voice = &mm_soft_voices[i];
+
+        if (voice->data != NULL)
+            mmSoftMixVoice(voice, mix, length);
+    }
+
+    mm_word remaining = length;
+
+    for (int segment = 0; segment < 2; segment++)
+    {
+        int16_t *left = planes->left[segment];
+        int16_t *right = planes->right[segment];
+        mm_word count = planes->length[segment];
+
+        if (count > remaining)
+            count = remaining;
+        remaining -= count;
+
+        for (mm_word i = 0; i < count; i++)
+        {
+            left[i] = mmSoftClamp(mix[0] >> 8);
+            right[i] = mmSoftClamp(mix[1] >> 8);
+            mix += 2;
+        }
+    }
+
+    return length;
+}
+
+mm_bool mmSoftMixOpen(mm_word stream_id, mm_word sampling_rate, mm_word buffer_length,
+                      mm_stream_timer timer)
+{
+    if (mm_soft_active || (sampling_rate == 0) || (buffer_length == 0))
+        return false;
+
+    if (stream_id >= MM_STREAM_MAX)
+        return false;
+
+    // The stream never requests more samples than the size of its buffer
+    mm_soft_mix_buffer = malloc(buffer_length * 2 * sizeof(mm_sword));
+    if (mm_soft_mix_buffer == NULL)
+        return false;
+
+    mm_soft_mix_length = buffer_length;
+    mm_soft_rate = sampling_rate;
+
+    memset(mm_soft_voices, 0, sizeof(mm_soft_voices));
+
+    mm_stream stream =
+    {
+        .sampling_rate = sampling_rate,
+        .buffer_length = buffer_length,
+        .callback = NULL,
+        .format = MM_STREAM_16BIT_STEREO,
+        .timer = timer,
+        .manual = false,
+    };
+
+    // The stream requests the first samples while it's opened
+    mm_soft_active = true;
+
+    if (!mmStreamOpenPlanarEx(stream_id, &stream, mmSoftMixCallback))
+    {
+        mm_soft_active = false;
+        free(mm_soft_mix_buffer);
+        mm_soft_mix_buffer = NULL;
+        mm_soft_mix_length = 0;
+        return false;
+    }
+
+    mm_soft_stream = stream_id;
+
+    return true;
+}
+
+void mmSoftMixClose(void)
+{
+    if (!mm_soft_active)
+        return;
+
+    mmStreamCloseEx(mm_soft_stream);
+
+    mm_soft_active = false;
+
+    memset(mm_soft_voices, 0, sizeof(mm_soft_voices));
+
+    free(mm_soft_mix_buffer);
+    mm_soft_mix_buffer = NULL;
+    mm_soft_mix_length = 0;
+}
+
+mm_sfxhand mmSoftEffectEx(mm_sound_effect *sound)
+{
+    if (!mm_soft_active)
+        return MM_SFXHAND_INVALID;
+
+    const mm_ds_sample *sample;
+    const void *data;
+
+    if (sound->id < 0x10000)
+    {
+        // This is using an ID number
+        if (sound->id >= mmSampleCount)
+            return MM_SFXHAND_INVALID;
+
+        mm_word sample_data = mmSampleBank[sound->id];
+        if (sample_data == 0)
+            return MM_SFXHAND_INVALID;
+
+        const mm_mas_ds_sample *mas = (const mm_mas_ds_sample *)
+            ((sample_data & 0x00FFFFFF) + BASE_SAMPLE_ADDRESS + sizeof(mm_mas_prefix));
+
+        sample = (const mm_ds_sample *)mas;
+        data = &mas->data[0];
+    }
+    else
+    {
+        sample = sound->sample;
+        data = sample->data;
+    }
+
+    mm_word shift;
+
+    if (sample->format == MM_SFORMAT_8BIT)
+        shift = 2;
+    else if (sample->format == MM_SFORMAT_16BIT)
+        shift = 1;
+    else
+        return MM_SFXHAND_INVALID; // ADPCM isn't supported by the software mixer
+
+    mm_soft_voice new_voice =
+    {
+        .data = data,
+        .end = (sample->loop_start + sample->length) << shift,
+        .loop_length = 0,
+        .position = 0,
+        .fraction = 0,
+        .step = mmSoftCalcStep(sample->base_rate, sound->rate),
+        .base_rate = sample->base_rate,
+        .format = sample->format,
+        .volume = sound->volume,
+        .panning = sound->panning,
+    };
+
+    if (sample->repeat_mode == MM_SREPEAT_FORWARD)
+        new_voice.loop_length = sample->loop_length << shift;
+
+    int oldIME = enterCriticalSection();
+
+    // Recycle the voice of the previous handle if it's still valid
+    mm_soft_voice *voice = mmSoftGetVoice(sound->handle);
+    mm_word index;
+
+    if (voice != NULL)
+    {
+        index = voice - &mm_soft_voices[0];
+    }
+    else
+    {
+        for (index = 0; index < MM_SOFT_VOICES; index++)
+        {
+            if (mm_soft_voices[index].data == NULL)
+                break;
+        }
+
+        if (index == MM_SOFT_VOICES)
+        {
+            leaveCriticalSection(oldIME);
+            return MM_SFXHAND_INVALID;
+        }
+
+        voice = &mm_soft_voices[index];
+    }
+
+    mm_soft_counter++;
+    new_voice.counter = mm_soft_counter;
+    *voice = new_voice;
+
+    leaveCriticalSection(oldIME);
+
+    return (mm_soft_counter << 8) | (index + 1);
+}
+
+mm_sfxhand mmSoftEffect(mm_word sample_ID)
+{
+    mm_sound_effect sound =
+    {
+        .id = sample_ID,
+        .rate = 1024,
+        .handle = 0,
+        .volume = 255,
+        .panning = 128,
+    };
+
+    return mmSoftEffectEx(&sound);
+}
+
+void mmSoftEffectCancel(mm_sfxhand handle)
+{
+    int oldIME = enterCriticalSection();
+
+    mm_soft_voice *voice = mmSoftGetVoice(handle);
+    if (voice != NULL)
+        voice->data = NULL;
+
+    leaveCriticalSection(oldIME);
+}
+
+void mmSoftEffectVolume(mm_sfxhand handle, mm_word volume)
+{
+    int oldIME = enterCriticalSection();
+
+    mm_soft_voice *voice = mmSoftGetVoice(handle);
+    if (voice != NULL)
+        voice->volume = volume > 255 ? 255 : volume;
+
+    leaveCriticalSection(oldIME);
+}
+
+void mmSoftEffectPanning(mm_sfxhand handle, mm_byte panning)
+{
+    int oldIME = enterCriticalSection();
+
+    mm_soft_voice *voice = mmSoftGetVoice(handle);
+    if (voice != NULL)
+        voice->panning = panning;
+
+    leaveCriticalSection(oldIME);
+}
+
+void mmSoftEffectRate(mm_sfxhand handle, mm_word rate)
+{
+    int oldIME = enterCriticalSection();
+
+    mm_soft_voice *voice = mmSoftGetVoice(handle);
+    if (voice != NULL)
+        voice->step = mmSoftCalcStep(voice->base_rate, rate);
+
+    leaveCriticalSection(oldIME);
+}
+
+mm_bool mmSoftEffectActive(mm_sfxhand handle)
+{
+    return mmSoftGetVoice(handle) != NULL;
+}
+
+mm_word mmSoftMixActiveVoices(void)
+{
+    mm_word count = 0;
+
+    for (int i = 0; i < MM_SOFT_VOICES; i++)
+    {
+        if (mm_soft_voices[i].data != NULL)
+            count++;
+    }
+
+    return count;
+}
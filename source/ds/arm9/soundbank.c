@@ -6,6 +6,9 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+
+#include <nds.h>
 
 #include <maxmod9.h>
 #include <mm_mas.h>
@@ -16,6 +19,10 @@
 
 #define MM_FILENAME_SIZE 64
 
+// Loops shorter than this (in words) are unrolled when samples are loaded from
+// the filesystem until they are at least this long.
+#define MM_LOOP_UNROLL_MIN 64
+
 // Pointer to the sound bank when it's stored in RAM. Not used when the sound
 // bank is in the filesystem.
 static msl_head *mmsAddress;
@@ -54,6 +61,60 @@ static mm_word mmsHandleMemoryOp(mm_word msg, mm_word param)
     return retval;
 }
 
+// Unroll short forward loops by appending copies of the loop to the end of the
+// sample. The software mixers of modes B and C have to handle the end of the
+// loop less often, and interpolation can read past the end of the loop. It
+// returns the new pointer to the data, which may have been reallocated.
+static mm_byte *mmUnrollSampleLoop(mm_byte *data, mm_word size)
+{
+    mm_mas_ds_sample *sample = (mm_mas_ds_sample *)(data + sizeof(mm_mas_prefix));
+
+    if (sample->repeat_mode != MM_SREPEAT_FORWARD)
+        return data;
+
+    // The data isn't stored right after the header
+    if (sample->point != 0)
+        return data;
+
+    mm_word loop_length = sample->loop_length;
+
+    if ((loop_length == 0) || (loop_length >= MM_LOOP_UNROLL_MIN))
+        return data;
+
+    mm_word copies = (MM_LOOP_UNROLL_MIN + loop_length - 1) / loop_length;
+    mm_word unroll = (copies - 1) * loop_length * sizeof(mm_word);
+
+    mm_word loop_end = sizeof(mm_mas_prefix) + sizeof(mm_mas_ds_sample)
+                     + (sample->loop_start + loop_length) * sizeof(mm_word);
+
+    // Malformed sample
+    if (loop_end > size)
+        return data;
+
+    mm_byte *new_data = realloc(data, loop_end + unroll);
+
+    // If there isn't enough memory, keep the original sample
+    if (new_data == NULL)
+        return data;
+
+    sample = (mm_mas_ds_sample *)(new_data + sizeof(mm_mas_prefix));
+
+    mm_byte *loop = new_data + loop_end - (loop_length * sizeof(mm_word));
+
+    for (mm_word i = 0; i < copies - 1; i++)
+        memcpy(new_data + loop_end + (i * loop_length * sizeof(mm_word)), loop,
+               loop_length * sizeof(mm_word));
+
+    sample->loop_length = loop_length * copies;
+
+    ((mm_mas_prefix *)new_data)->size = loop_end + unroll - sizeof(mm_mas_prefix);
+
+    // The ARM7 reads the sample from main RAM
+    DC_FlushRange(new_data, loop_end + unroll);
+
+    return new_data;
+}
+
 // Load a file from the soundbank and return memory pointer, if it succeeded
 static mm_word mmLoadDataFromSoundBank(mm_word index, mm_word command)
 {
@@ -111,6 +172,9 @@ static mm_word mmLoadDataFromSoundBank(mm_word index, mm_word command)
 
     fclose(fp);
 
+    if (command == 1)
+        data = mmUnrollSampleLoop(data, size);
+
     return (mm_word)data;
 
 error:
@@ -9,6 +9,14 @@
 
 #include <mm_types.h>
 
+// Maximum size of a datamsg sent from the ARM9, including the length byte. A
+// datamsg can contain several commands (see mmBeginBatch()).
+#define MAX_DATAMSG_SIZE    64
+
+// Maximum size of a command wrapped in a MSG_SCHEDULE message, including the
+// message ID.
+#define MAX_SCHEDULED_COMMAND_SIZE  16
+
 enum mm_message_ids
 {
     MSG_BANK            = 0x00, // Get sound bank and number of songs and samples
@@ -49,7 +57,24 @@ enum mm_message_ids
 
     MSG_STREAMVOL       = 0x1F, // Set stream volume
 
-    // 0x20 to 0x3F are reserved
+    MSG_BUSVOL          = 0x20, // Set mix bus volume
+    MSG_DUCKING         = 0x21, // Configure music ducking
+    MSG_INTERPOLATION   = 0x22, // Select mode B interpolation
+    MSG_MODEBCONFIG     = 0x23, // Configure mode B slices
+    MSG_MODECVOICES     = 0x24, // Set mode C hardware and software channels
+    MSG_MODECBUDGET     = 0x25, // Set mode C software mixing budget
+    MSG_SELECTMODELIVE  = 0x26, // Select audio mode keeping the audio
+    MSG_MODULERAMP      = 0x27, // Set module volume ramp
+    MSG_EFFECTRAMP      = 0x28, // Set effect volume ramp
+    MSG_LOADBLOCK       = 0x29, // Set address of the ARM7 load statistics
+    // 0x2A is unused
+    MSG_COMMANDRING     = 0x2B, // Set address of the ring of commands
+    MSG_EFFECTEXHANDLE  = 0x2C, // Play effect with a handle chosen by the ARM9
+    MSG_STATUSBLOCK     = 0x2D, // Set address of the ARM7 status block
+    MSG_EVENTRING       = 0x2E, // Set address of the ring of song events
+    MSG_SCHEDULE        = 0x2F, // Run a command at a given mixer time
+
+    // 0x30 to 0x3F are reserved
 };
 
 enum mm_arm7_msg_ids
@@ -57,6 +82,7 @@ enum mm_arm7_msg_ids
     MSG_ARM7_UPDATE = 0,
     MSG_ARM7_SONG_EVENT = 1,
     MSG_ARM7_STREAM_READY = 2,
+    MSG_ARM7_SFX_FREED = 3, // Effect channel of the ARM9 freed
 };
 
 #endif // MM_DS_COMMON_COMM_MESSAGES_H__
@@ -0,0 +1,22 @@
+// SPDX-License-Identifier: ISC
+//
+// Copyright (c) 2026, Antonio Niño Díaz (antonio_nd@outlook.com)
+
+#ifndef MM_DS_COMMON_EVENTS_H__
+#define MM_DS_COMMON_EVENTS_H__
+
+// After the ARM9 has sent the address of a ring buffer (see ring.h) the ARM7
+// writes song events to it instead of sending one FIFO message per event. Each
+// record is EVENT_RECORD_WORDS long:
+//
+//     word 0: msg | (param << 8) | (layer << 16)
+//     word 1: tick | (row << 8) | (position << 16)
+//     word 2: value of the mixer clock at the start of the update
+//
+// The ARM7 is the producer and the ARM9 is the consumer.
+
+#define EVENT_RECORD_WORDS  3
+
+#define EVENT_RING_WORDS    256 // Must be a power of two
+
+#endif // MM_DS_COMMON_EVENTS_H__
@@ -0,0 +1,47 @@
+// SPDX-License-Identifier: ISC
+//
+// Copyright (c) 2026, Antonio Niño Díaz (antonio_nd@outlook.com)
+
+#ifndef MM_DS_COMMON_MODE_B_H__
+#define MM_DS_COMMON_MODE_B_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <mm_types.h>
+
+// Samples per channel of the default output buffer of mode B. The ARM7 doesn't
+// reserve it in its WRAM: the ARM9 allocates it in main RAM the first time that
+// mode B is selected without an output buffer from the application.
+#define MM_MODE_B_DEFAULT_SAMPLES   256
+
+// Size in bytes of the default output buffer (16 channels of 16-bit samples)
+#define MM_MODE_B_DEFAULT_SIZE      (16 * MM_MODE_B_DEFAULT_SAMPLES * 2)
+
+// Check a mode B configuration. This is used by the ARM9 so that it can return
+// the result without waiting for the ARM7.
+static inline bool mmModeBConfigIsValid(const mm_mode_b_config *config)
+{
+    mm_word length = config->slice_length;
+    mm_word count = config->slice_count;
+
+    if ((length < MM_MODE_B_SLICE_MIN) || (length > MM_MODE_B_SLICE_MAX))
+        return false;
+
+    if ((length % 32) != 0)
+        return false;
+
+    if ((count < 2) || (count > MM_MODE_B_SLICES_MAX))
+        return false;
+
+    if ((uintptr_t)config->output & 3)
+        return false;
+
+    if ((config->output == NULL) && (length * count > MM_MODE_B_DEFAULT_SAMPLES))
+        return false;
+
+    return true;
+}
+
+#endif // MM_DS_COMMON_MODE_B_H__
@@ -0,0 +1,101 @@
+// SPDX-License-Identifier: ISC
+//
+// Copyright (c) 2026, Antonio Niño Díaz (antonio_nd@outlook.com)
+
+#ifndef MM_DS_COMMON_RING_H__
+#define MM_DS_COMMON_RING_H__
+
+#include <mm_types.h>
+
+// Ring buffer of words in main RAM shared by the ARM9 and the ARM7. Only one
+// CPU writes to it and only the other one reads from it, so it doesn't need
+// any lock: the producer only modifies "write" and the consumer only modifies
+// "read". The indices are free running, they are only masked when accessing
+// the data.
+//
+// The ARM9 must access the ring through the uncached mirror of main RAM. The
+// data is always written before the index that makes it visible, and the
+// ARM946E-S drains its write buffer in order, so the other CPU never sees an
+// index that points to data that isn't in RAM yet.
+typedef struct
+{
+    volatile mm_word write; // Modified by the producer only
+    volatile mm_word read;  // Modified by the consumer only
+    mm_word size;           // Size of data[] in words. It must be a power of 2
+    mm_word data[];
+} mm_ring;
+
+// Prevent the compiler from moving memory accesses across this point
+static inline void mmRingBarrier(void)
+{
+    __asm__ volatile("" ::: "memory");
+}
+
+static inline void mmRingInit(mm_ring *ring, mm_word size)
+{
+    ring->write = 0;
+    ring->read = 0;
+    ring->size = size;
+}
+
+// Number of words that can be read
+static inline mm_word mmRingUsed(const mm_ring *ring)
+{
+    return ring->write - ring->read;
+}
+
+// Number of words that can be written
+static inline mm_word mmRingFree(const mm_ring *ring)
+{
+    return ring->size - (ring->write - ring->read);
+}
+
+// Returns the next word without removing it. The ring must not be empty.
+static inline mm_word mmRingPeek(const mm_ring *ring)
+{
+    mmRingBarrier();
+
+    return ring->data[ring->read & (ring->size - 1)];
+}
+
+// Copy "count" words to the ring. Nothing is written if they don't fit.
+static inline mm_bool mmRingPush(mm_ring *ring, const mm_word *words, mm_word count)
+{
+    mm_word write = ring->write;
+    mm_word mask = ring->size - 1;
+
+    if (ring->size - (write - ring->read) < count)
+        return false;
+
+    for (mm_word i = 0; i < count; i++)
+        ring->data[(write + i) & mask] = words[i];
+
+    mmRingBarrier();
+
+    ring->write = write + count;
+
+    return true;
+}
+
+// Copy "count" words from the ring. Nothing is read if there aren't enough.
+static inline mm_bool mmRingPop(mm_ring *ring, mm_word *words, mm_word count)
+{
+    mm_word read = ring->read;
+    mm_word mask = ring->size - 1;
+
+    if (ring->write - read < count)
+        return false;
+
+    mmRingBarrier();
+
+    for (mm_word i = 0; i < count; i++)
+        words[i] = ring->data[(read + i) & mask];
+
+    mmRingBarrier();
+
+    ring->read = read + count;
+
+    return true;
+}
+
+#endif // MM_DS_COMMON_RING_H__
@@ -0,0 +1,31 @@
+// SPDX-License-Identifier: ISC
+//
+// Copyright (c) 2026, Antonio Niño Díaz (antonio_nd@outlook.com)
+
+#ifndef MM_DS_COMMON_STATUS_H__
+#define MM_DS_COMMON_STATUS_H__
+
+#include <mm_types.h>
+
+#include "core/effect.h"
+
+// Status of the ARM7 published in main RAM once per mixer update. It's
+// protected by a sequence counter: the ARM7 makes it odd before changing the
+// block and even again when it's done. The ARM9 copies the block, and it tries
+// again if the counter was odd or has changed during the copy.
+typedef struct
+{
+    volatile mm_word sequence;
+    mm_arm7_status status;
+
+    // Handle that owns each effect channel, or 0 if the channel is free
+    mm_sfxhand effects[EFFECT_CHANNELS_TOTAL];
+} mm_status_block;
+
+// Prevent the compiler from moving memory accesses across this point
+static inline void mmStatusBarrier(void)
+{
+    __asm__ volatile("" ::: "memory");
+}
+
+#endif // MM_DS_COMMON_STATUS_H__
@@ -31,10 +31,6 @@
 
 #define START_CHANNEL_LOOP 0x88
 
-#define CHANNEL_LEFT    4
-#define CHANNEL_CENTER  4
-#define CHANNEL_RIGHT   5
-
 #define NUM_TIMERS      4
 
 #ifdef ARM7
@@ -57,11 +53,27 @@ static void mmRestoreIRQ_t(void)
 
 #endif // ARM7
 
-static mm_hword mmsPreviousTimer;
-static mm_word StreamCounter;
-static mm_stream_data mmsData;
+// Function that copies data from the work buffer to the wave buffer. It's
+// selected when the stream is opened, depending on its format.
+typedef mm_byte *(*mm_stream_copy_func)(mm_stream_data *data, mm_byte *work_memory_ptr,
+                                        mm_word dest_pos, mm_word curr_samples_num);
+
+static mm_stream_data mmsStreams[MM_STREAM_MAX];
+static mm_stream_copy_func mmsCopyData[MM_STREAM_MAX];
+
+// Stream that uses each hardware timer, or NULL if the timer is free
+static mm_stream_data *mmsTimerStream[NUM_TIMERS];
+
 #ifdef ARM7
-static mm_byte streamVolume = MAX_VOLUME;
+static mm_byte mmsVolume[MM_STREAM_MAX] = { [0 ... MM_STREAM_MAX - 1] = MAX_VOLUME };
+
+// Left and right hardware channels of each stream. Mono streams only use the
+// left one. Channels 6 and 7 are left free because they are used by the
+// interpolated mixing mode.
+static const mm_byte mmsChannels[MM_STREAM_MAX][2] =
+{
+    { 4, 5 }, { 2, 3 }, { 0, 1 }, { 8, 9 }
+};
 #endif
 
 // Checks if a format is stereo or not
@@ -137,11 +149,11 @@ static mm_byte get_cnt_format(mm_stream_formats format)
 #endif
 
 // Copy mono data with different shifts
-// It may be better to keep everything separate for faster speeds?!
-static ARM_CODE mm_byte *CopyDataMonoStream(mm_byte *work_memory_ptr, mm_word dest_pos,
-                                            mm_word curr_samples_num, mm_word shift)
+static ARM_CODE mm_byte *CopyDataMonoStream(mm_stream_data *data, mm_byte *work_memory_ptr,
+                                            mm_word dest_pos, mm_word curr_samples_num)
 {
-    mm_byte* wave_memory_ptr = (mm_byte*)mmsData.wave_memory;
+    mm_word shift = get_shift_for_format(data->format);
+    mm_byte* wave_memory_ptr = (mm_byte*)data->wave_memory;
 
     wave_memory_ptr += (dest_pos << shift) >> 1;
 
@@ -169,13 +181,14 @@ static ARM_CODE mm_byte *CopyDataMonoStream(mm_byte *work_memory_ptr, mm_word de
     return work_memory_ptr;
 }
 
-// Copy stereo data with different shifts
-// It may be better to keep everything separate for faster speeds?!
-static ARM_CODE mm_byte *CopyDataStereoStream(mm_byte *work_memory_ptr, mm_word dest_pos,
-                                              mm_word curr_samples_num, mm_word shift,
-                                              mm_word length)
+// Copy stereo data with different shifts. Only used for formats that don't have
+// a specialized function.
+static ARM_CODE mm_byte *CopyDataStereoStream(mm_stream_data *data, mm_byte *work_memory_ptr,
+                                              mm_word dest_pos, mm_word curr_samples_num)
 {
-    mm_byte *wave_memory_ptr = (mm_byte*)mmsData.wave_memory;
+    mm_word shift = get_shift_for_format(data->format);
+    mm_word length = data->length_cut;
+    mm_byte *wave_memory_ptr = (mm_byte*)data->wave_memory;
     mm_word left = 0;
     mm_word right = 0;
 
@@ -204,16 +217,113 @@ static ARM_CODE mm_byte *CopyDataStereoStream(mm_byte *work_memory_ptr, mm_word
     return work_memory_ptr;
 }
 
+// Copy stereo 8-bit data. Most of it is copied in blocks of 8 samples.
+static ARM_CODE mm_byte *CopyDataStereo8Stream(mm_stream_data *data, mm_byte *work_memory_ptr,
+                                               mm_word dest_pos, mm_word curr_samples_num)
+{
+    mm_byte *left = (mm_byte *)data->wave_memory + dest_pos;
+    mm_byte *right = left + data->length_cut;
+    mm_word count = curr_samples_num;
+
+    // Copy single samples until the destination is aligned to 4 bytes
+    while ((count > 0) && (((uintptr_t)left & 3) != 0))
+    {
+        *left++ = work_memory_ptr[0];
+        *right++ = work_memory_ptr[1];
+        work_memory_ptr += 2;
+        count--;
+    }
+
+    // The source may still be unaligned if the destination wasn't aligned
+    if (((uintptr_t)work_memory_ptr & 3) == 0)
+    {
+        mm_word blocks = count >> 3;
+
+        mmStreamDeinterleave8(work_memory_ptr, left, right, blocks);
+
+        work_memory_ptr += blocks * 16;
+        left += blocks * 8;
+        right += blocks * 8;
+        count &= 7;
+    }
+
+    while (count > 0)
+    {
+        *left++ = work_memory_ptr[0];
+        *right++ = work_memory_ptr[1];
+        work_memory_ptr += 2;
+        count--;
+    }
+
+    return work_memory_ptr;
+}
+
+// Copy stereo 16-bit data. Most of it is copied in blocks of 4 samples.
+static ARM_CODE mm_byte *CopyDataStereo16Stream(mm_stream_data *data, mm_byte *work_memory_ptr,
+                                                mm_word dest_pos, mm_word curr_samples_num)
+{
+    mm_hword *left = (mm_hword *)data->wave_memory + dest_pos;
+    mm_hword *right = left + data->length_cut;
+    mm_word *src = (mm_word *)work_memory_ptr;
+    mm_word count = curr_samples_num;
+
+    // Copy one sample if the destination isn't aligned to 4 bytes. The source
+    // is always aligned.
+    if ((count > 0) && (((uintptr_t)left & 3) != 0))
+    {
+        mm_word value = *src++;
+        *left++ = value;
+        *right++ = value >> 16;
+        count--;
+    }
+
+    mm_word blocks = count >> 2;
+
+    mmStreamDeinterleave16(src, left, right, blocks);
+
+    src += blocks * 4;
+    left += blocks * 4;
+    right += blocks * 4;
+    count &= 3;
+
+    while (count > 0)
+    {
+        mm_word value = *src++;
+        *left++ = value;
+        *right++ = value >> 16;
+        count--;
+    }
+
+    return (mm_byte *)src;
+}
+
+// Select the function that copies data to the wave buffer
+static mm_stream_copy_func GetCopyFunction(mm_stream_formats format)
+{
+    switch (format)
+    {
+        case MM_STREAM_8BIT_STEREO:
+            return CopyDataStereo8Stream;
+        case MM_STREAM_16BIT_STEREO:
+            return CopyDataStereo16Stream;
+        default:
+            if (is_stereo_format(format))
+                return CopyDataStereoStream;
+
+            return CopyDataMonoStream;
+    }
+}
+
 // Copy/de-interleave data from work buffer into the wave buffer
-static ARM_CODE void CopyDataToStream(mm_word num_samples)
+static ARM_CODE void CopyDataToStream(mm_stream_data *data, mm_word num_samples)
 {
     // Do nothing if there is no data
     if (num_samples == 0)
         return;
 
-    mm_word position = mmsData.position;
-    mm_word length = mmsData.length_cut;
-    mm_byte* work_memory_ptr = (mm_byte*)mmsData.work_memory;
+    mm_word position = data->position;
+    mm_word length = data->length_cut;
+    mm_byte* work_memory_ptr = (mm_byte*)data->work_memory;
 
     while (num_samples != 0)
     {
@@ -233,20 +343,101 @@ static ARM_CODE void CopyDataToStream(mm_word num_samples)
 
         num_samples -= curr_samples_num;
 
-        if (is_stereo_format(mmsData.format))
-            work_memory_ptr = CopyDataStereoStream(work_memory_ptr, dest_pos, curr_samples_num, get_shift_for_format(mmsData.format), length);
-        else
-            work_memory_ptr = CopyDataMonoStream(work_memory_ptr, dest_pos, curr_samples_num, get_shift_for_format(mmsData.format));
+        work_memory_ptr = mmsCopyData[data->id](data, work_memory_ptr, dest_pos, curr_samples_num);
+    }
+
+    data->position = position;
+}
+
+// Get the address of a sample of a channel in the wave buffer. In stereo
+// streams, channel 1 is the right channel.
+static mm_byte *GetStreamPlane(mm_stream_data *data, mm_word channel, mm_word position)
+{
+    mm_word shift = get_shift_for_format(data->format);
+    mm_byte *wave_memory_ptr = (mm_byte *)data->wave_memory;
+
+    wave_memory_ptr += ((channel * data->length_cut) << shift) >> 1;
+
+    return wave_memory_ptr + ((position << shift) >> 1);
+}
+
+#ifdef ARM9
+// Flush the part of the wave buffer that has been written since "position"
+static void FlushStreamRange(mm_stream_data *data, mm_word position, mm_word num_samples)
+{
+    mm_word channels = is_stereo_format(data->format) ? 2 : 1;
+    mm_word shift = get_shift_for_format(data->format);
+
+    while (num_samples != 0)
+    {
+        mm_word curr_samples_num = data->length_cut - position;
+        if (curr_samples_num > num_samples)
+            curr_samples_num = num_samples;
+
+        for (mm_word channel = 0; channel < channels; channel++)
+            DC_FlushRange(GetStreamPlane(data, channel, position), (curr_samples_num << shift) >> 1);
+
+        num_samples -= curr_samples_num;
+        position = 0;
+    }
+}
+#endif
+
+// Request samples to the planar callback, which writes them directly to the
+// wave buffer. It returns the number of samples written.
+static mm_word PlanarStreamRequest(mm_stream_data *data, mm_word num_samples)
+{
+    mm_word position = data->position;
+    mm_word remaining_samples = data->length_cut - position;
+
+    mm_stream_planes planes;
+
+    planes.length[0] = num_samples;
+    planes.length[1] = 0;
+
+    if (num_samples > remaining_samples)
+    {
+        planes.length[0] = remaining_samples;
+        planes.length[1] = num_samples - remaining_samples;
     }
 
-    mmsData.position = position;
+    planes.left[0] = GetStreamPlane(data, 0, position);
+    planes.left[1] = GetStreamPlane(data, 0, 0);
+
+    if (is_stereo_format(data->format))
+    {
+        planes.right[0] = GetStreamPlane(data, 1, position);
+        planes.right[1] = GetStreamPlane(data, 1, 0);
+    }
+    else
+    {
+        planes.right[0] = NULL;
+        planes.right[1] = NULL;
+    }
+
+    mm_word filled_samples = data->planar_callback(num_samples, &planes, data->format);
+
+    if (filled_samples > num_samples)
+        filled_samples = num_samples;
+
+#ifdef ARM9
+    FlushStreamRange(data, position, filled_samples);
+#endif
+
+    position += filled_samples;
+    if (position >= data->length_cut)
+        position -= data->length_cut;
+
+    data->position = position;
+
+    return filled_samples;
 }
 
 // Executes the stream update
-static void StreamExecuteUpdate(mm_word stream_position)
+static void StreamExecuteUpdate(mm_stream_data *data, mm_word stream_position)
 {
-    // Update StreamCounter
-    StreamCounter += stream_position;
+    // Update the number of samples played
+    data->counter += stream_position;
 
     while (stream_position != 0)
     {
@@ -254,18 +445,36 @@ static void StreamExecuteUpdate(mm_word stream_position)
 
         // Cut to work buffer size
         // TODO: This was only > in the asm, but it could cause issues...?
-        if (processing_samples >= mmsData.length_cut)
-            processing_samples = mmsData.length_cut - 1;
+        if (processing_samples >= data->length_cut)
+            processing_samples = data->length_cut - 1;
+
+        mm_word filled_samples;
+
+        if (data->planar_callback != NULL)
+        {
+            // The callback writes the samples to the wave buffer
+            filled_samples = PlanarStreamRequest(data, processing_samples);
+        }
+        else
+        {
+            // Do callback
+            filled_samples = data->callback(processing_samples, data->work_memory, data->format);
+
+            // Prevent bad filling...?
+            //if(filled_samples > processing_samples)
+            //    filled_samples = processing_samples;
 
-        // Do callback
-        mm_word filled_samples = mmsData.callback(processing_samples, mmsData.work_memory, mmsData.format);
+#ifdef ARM9
+            mm_word position = data->position;
+#endif
 
-        // Prevent bad filling...?
-        //if(filled_samples > processing_samples)
-        //    filled_samples = processing_samples;
+            // Copy samples to stream
+            CopyDataToStream(data, filled_samples);
 
-        // Copy samples to stream
-        CopyDataToStream(filled_samples);
+#ifdef ARM9
+            FlushStreamRange(data, position, filled_samples);
+#endif
+        }
 
         // Processed samples
         stream_position -= filled_samples;
@@ -273,241 +482,401 @@ static void StreamExecuteUpdate(mm_word stream_position)
         // Break if 0 samples output or remaining < amount filled
         if ((filled_samples == 0) || (stream_position < filled_samples))
         {
-            mmsData.remainder += stream_position * mmsData.clocks;
+            data->remainder += stream_position * data->clocks;
             break;
         }
     }
-
-#ifdef ARM9
-    DC_FlushRange(mmsData.wave_memory, mmsData.length_words * 4);
-#endif
 }
 
 // Force a data request
-static void ForceStreamRequest(mm_word num_samples)
+static void ForceStreamRequest(mm_stream_data *data, mm_word num_samples)
 {
-    StreamExecuteUpdate((num_samples >> 2) << 2);
+    StreamExecuteUpdate(data, (num_samples >> 2) << 2);
 }
 
-#ifdef ARM7
-void mmStreamOpen(mm_stream *stream, mm_addr wavebuffer, mm_addr workbuffer)
+// Utility function which gets and updates (if needed) the number of samples played since the start
+static mm_word getAndUpdateStreamPosition(mm_stream_data *data, mm_bool update)
 {
-#else
-void mmStreamOpen(mm_stream *stream)
+    mm_word time = data->timer;
+
+    // Manual has different code
+    if (!data->is_auto)
+    {
+        time = data->hw_timer[0];
+        mm_word previous_time = data->previous_timer;
+
+        // Handle updating data
+        if (update)
+            data->previous_timer = time;
+
+        // Handle overflow
+        if (time < previous_time)
+            time += 1 << 16;
+        time -= previous_time;
+    }
+
+    mm_word num_samples = (((time * TIMER_SPEED) + data->remainder) / data->clocks);
+
+    if (update)
+    {
+        // Floors to multiple of 4 and updates remainder
+        data->remainder = (((time * TIMER_SPEED) + data->remainder) % data->clocks) + ((num_samples & 3) * data->clocks);
+        num_samples = (num_samples >> 2) << 2;
+    }
+
+    return num_samples;
+}
+
+// Timer interrupt handlers. Each stream in automatic mode gets the interrupt of
+// its own timer.
+static void StreamTimerUpdate(mm_word timer)
 {
-#endif
-    // Check if it has already been opened
-    if (mmsData.is_active)
+    mm_stream_data *data = mmsTimerStream[timer];
+
+    // Catch inactive stream
+    if ((data == NULL) || !data->is_active)
         return;
 
-#ifdef ARM7
-    // Save args if ARM7
-    mmsData.wave_memory = wavebuffer;
-    mmsData.work_memory = workbuffer;
-#endif
+    // Determine how many samples to mix
+    StreamExecuteUpdate(data, getAndUpdateStreamPosition(data, 1));
+}
+
+static void StreamTimer0Handler(void)
+{
+    StreamTimerUpdate(0);
+}
+
+static void StreamTimer1Handler(void)
+{
+    StreamTimerUpdate(1);
+}
+
+static void StreamTimer2Handler(void)
+{
+    StreamTimerUpdate(2);
+}
+
+static void StreamTimer3Handler(void)
+{
+    StreamTimerUpdate(3);
+}
+
+static const mm_voidfunc mmsTimerHandlers[NUM_TIMERS] =
+{
+    StreamTimer0Handler, StreamTimer1Handler,
+    StreamTimer2Handler, StreamTimer3Handler
+};
+
+// Open a stream that uses the callback of the mm_stream struct, or the planar
+// callback if it isn't NULL. It returns false if the stream can't be opened.
+static mm_bool StreamOpen(mm_word id, mm_stream *stream, mm_stream_planar_func planar_callback,
+                       mm_addr wavebuffer, mm_addr workbuffer)
+{
+    // Check bad stream selection
+    if (id >= MM_STREAM_MAX)
+        return false;
+
+    mm_stream_data *data = &mmsStreams[id];
+
+    // Check if it has already been opened
+    if (data->is_active)
+        return false;
 
     // Check bad timer selection
     if (stream->timer >= NUM_TIMERS)
-        return;
+        return false;
+
+    // Each stream needs its own timer
+    if (mmsTimerStream[stream->timer] != NULL)
+        return false;
 
     // Check bad rate (for division)
     if (stream->sampling_rate == 0)
-        return;
+        return false;
+
+#ifdef ARM7
+    // Save args if ARM7
+    data->wave_memory = wavebuffer;
+    data->work_memory = workbuffer;
+#else
+    (void)wavebuffer;
+    (void)workbuffer;
+#endif
+
+    data->id = id;
 
     // Set active
-    mmsData.is_active = 1;
+    data->is_active = 1;
 
     // Calc hwtimer address
     // hw_timer_num did not exist, but it can save writing some annoying code
-    mmsData.hw_timer_num = stream->timer;
-    mmsData.hw_timer = &TIMER_DATA(mmsData.hw_timer_num);
+    data->hw_timer_num = stream->timer;
+    data->hw_timer = &TIMER_DATA(data->hw_timer_num);
 
     // Reset timer
-    mmsData.hw_timer[0] = TIMER_DISABLE;
-    mmsData.hw_timer[1] = TIMER_DISABLE;
-
-    // Setup IRQ vector
-    irqSet(IRQ_TIMER(mmsData.hw_timer_num), mmStreamUpdate);
-    irqEnable(IRQ_TIMER(mmsData.hw_timer_num));
+    data->hw_timer[0] = TIMER_DISABLE;
+    data->hw_timer[1] = TIMER_DISABLE;
 
     // Calc Clocks (must be divisible by 2 for SOUND)
-    mmsData.clocks = ((CLOCK / stream->sampling_rate) >> 1) << 1;
+    data->clocks = ((CLOCK / stream->sampling_rate) >> 1) << 1;
 
     // Copy length cut to multiple of 16
-    mmsData.length_cut = (stream->buffer_length >> 4) << 4;
+    data->length_cut = (stream->buffer_length >> 4) << 4;
 
     // Copy format
-    mmsData.format = (mm_stream_formats)stream->format;
+    data->format = (mm_stream_formats)stream->format;
+
+    // Select the function that de-interleaves the data of this format
+    mmsCopyData[id] = GetCopyFunction(data->format);
 
-    mm_word length = mmsData.length_cut;
+    mm_word length = data->length_cut;
 
     // Shift left if stereo
-    if (is_stereo_format(mmsData.format))
+    if (is_stereo_format(data->format))
         length <<= 1;
 
     // Shift left if 16 bit
-    if (is_16bit_format(mmsData.format))
+    if (is_16bit_format(data->format))
         length <<= 1;
 
     // Shift right if 4 bit
 #ifdef MM_SUPPORT_4BIT_STREAM
-    if (is_4bit_format(mmsData.format))
+    if (is_4bit_format(data->format))
          length >>= 1;
 #endif
 
     // Save real length (words)
-    mmsData.length_words = length >> 2;
+    data->length_words = length >> 2;
 
 #ifdef ARM9
-    // Allocate memory on the ARM9
-    mmsData.wave_memory = calloc(length, 1);
-    mmsData.work_memory = calloc(length, 1);
+    // Allocate memory on the ARM9. Planar callbacks don't need a work buffer.
+    data->wave_memory = calloc(length, 1);
+    data->work_memory = NULL;
+    if (planar_callback == NULL)
+        data->work_memory = calloc(length, 1);
 #endif
 
     // Handle malloc failure, in general
-    if ((mmsData.wave_memory == NULL) || (mmsData.work_memory == NULL))
+    if ((data->wave_memory == NULL) ||
+        ((planar_callback == NULL) && (data->work_memory == NULL)))
     {
-        mmsData.is_active = 0;
+        data->is_active = 0;
 #ifdef ARM9
-        free(mmsData.wave_memory);
-        free(mmsData.work_memory);
+        free(data->wave_memory);
+        free(data->work_memory);
 #endif
-        return;
+        return false;
     }
 
+    // Setup IRQ vector
+    mmsTimerStream[data->hw_timer_num] = data;
+    irqSet(IRQ_TIMER(data->hw_timer_num), mmsTimerHandlers[data->hw_timer_num]);
+    irqEnable(IRQ_TIMER(data->hw_timer_num));
+
     // Reset wave memory
-    for (int i = 0; i < mmsData.length_words; i++)
-        ((mm_word*)mmsData.wave_memory)[i] = 0;
+    for (int i = 0; i < data->length_words; i++)
+        ((mm_word*)data->wave_memory)[i] = 0;
+
+#ifdef ARM9
+    // Updates only flush the part of the buffer that they write
+    DC_FlushRange(data->wave_memory, data->length_words * 4);
+#endif
 
     // Copy function
-    mmsData.callback = stream->callback;
+    data->callback = stream->callback;
+    data->planar_callback = planar_callback;
 
     // Clear remainder
-    mmsData.remainder = 0;
+    data->remainder = 0;
 
     // Reset position
-    mmsData.position = 0;
+    data->position = 0;
 
     // Copy is_auto info
-    mmsData.is_auto = !stream->manual;
+    data->is_auto = !stream->manual;
 
-    mmsData.timer = ((mmsData.clocks * mmsData.length_cut) / 2) / TIMER_SPEED;
+    data->timer = ((data->clocks * data->length_cut) / 2) / TIMER_SPEED;
 
-    mmsPreviousTimer = 0;
+    data->previous_timer = 0;
 
     // Force-fill stream with initial data
-    ForceStreamRequest(mmsData.length_cut - DELAY_SAMPLES);
+    ForceStreamRequest(data, data->length_cut - DELAY_SAMPLES);
 
     // Reset stream counter
-    StreamCounter = 0;
+    data->counter = 0;
 
     //mmSuspendIRQ_t();
 
-    mmStreamBegin(mmsData.wave_memory, mmsData.clocks >> 1, mmsData.length_cut, mmsData.format);
+    mmStreamBegin(id, data->wave_memory, data->clocks >> 1, data->length_cut, data->format);
 
     // Start timer
-    if (mmsData.is_auto)
+    if (data->is_auto)
     {
-        mmsData.hw_timer[0] = -mmsData.timer;
-        mmsData.hw_timer[1] = TIMER_AUTO;
+        data->hw_timer[0] = -data->timer;
+        data->hw_timer[1] = TIMER_AUTO;
     }
     else
     {
-        mmsData.hw_timer[0] = 0;
-        mmsData.hw_timer[1] = TIMER_MANUAL;
+        data->hw_timer[0] = 0;
+        data->hw_timer[1] = TIMER_MANUAL;
     }
 
     //mmRestoreIRQ_t();
+
+    return true;
 }
 
-// Utility function which gets and updates (if needed) the number of samples played since the start
-static mm_word getAndUpdateStreamPosition(mm_bool update)
+#ifdef ARM7
+mm_bool mmStreamOpenEx(mm_word id, mm_stream *stream, mm_addr wavebuffer, mm_addr workbuffer)
 {
-    mm_word time = mmsData.timer;
+    return StreamOpen(id, stream, NULL, wavebuffer, workbuffer);
+}
 
-    // Manual has different code
-    if (!mmsData.is_auto)
-    {
-        time = mmsData.hw_timer[0];
-        mm_word previous_time = mmsPreviousTimer;
+void mmStreamOpen(mm_stream *stream, mm_addr wavebuffer, mm_addr workbuffer)
+{
+    StreamOpen(0, stream, NULL, wavebuffer, workbuffer);
+}
 
-        // Handle updating data
-        if (update)
-            mmsPreviousTimer = time;
+mm_bool mmStreamOpenPlanarEx(mm_word id, mm_stream *stream, mm_stream_planar_func callback,
+                             mm_addr wavebuffer)
+{
+    if (callback == NULL)
+        return false;
 
-        // Handle overflow
-        if (time < previous_time)
-            time += 1 << 16;
-        time -= previous_time;
-    }
+    return StreamOpen(id, stream, callback, wavebuffer, NULL);
+}
+
+void mmStreamOpenPlanar(mm_stream *stream, mm_stream_planar_func callback,
+                        mm_addr wavebuffer)
+{
+    mmStreamOpenPlanarEx(0, stream, callback, wavebuffer);
+}
+#else
+mm_bool mmStreamOpenEx(mm_word id, mm_stream *stream)
+{
+    return StreamOpen(id, stream, NULL, NULL, NULL);
+}
 
-    mm_word num_samples = (((time * TIMER_SPEED) + mmsData.remainder) / mmsData.clocks);
+void mmStreamOpen(mm_stream *stream)
+{
+    StreamOpen(0, stream, NULL, NULL, NULL);
+}
 
-    if (update)
-    {
-        // Floors to multiple of 4 and updates remainder
-        mmsData.remainder = (((time * TIMER_SPEED) + mmsData.remainder) % mmsData.clocks) + ((num_samples & 3) * mmsData.clocks);
-        num_samples = (num_samples >> 2) << 2;
-    }
+mm_bool mmStreamOpenPlanarEx(mm_word id, mm_stream *stream, mm_stream_planar_func callback)
+{
+    if (callback == NULL)
+        return false;
 
-    return num_samples;
+    return StreamOpen(id, stream, callback, NULL, NULL);
+}
+
+void mmStreamOpenPlanar(mm_stream *stream, mm_stream_planar_func callback)
+{
+    mmStreamOpenPlanarEx(0, stream, callback);
+}
+#endif
+
+// Returns the data of an open stream, or NULL if it isn't open. On the ARM7,
+// streams opened by the ARM9 are active too, but they aren't returned because
+// they don't have a timer or a callback on this CPU.
+static mm_stream_data *GetActiveStream(mm_word id)
+{
+    if (id >= MM_STREAM_MAX)
+        return NULL;
+
+    mm_stream_data *data = &mmsStreams[id];
+
+    if (!data->is_active)
+        return NULL;
+
+    if (mmsTimerStream[data->hw_timer_num] != data)
+        return NULL;
+
+    return data;
 }
 
 // Get number of samples that have played since start.
 // 32-bit variable overflows every ~36 hours @ 32khz...
-mm_word mmStreamGetPosition(void)
+mm_word mmStreamGetPositionEx(mm_word id)
 {
     // Catch inactive stream
-    if (!mmsData.is_active)
+    mm_stream_data *data = GetActiveStream(id);
+    if (data == NULL)
         return 0;
 
     // Catch auto mode
     // (Only manual mode supported)
-    if (mmsData.is_auto)
+    if (data->is_auto)
         return 0;
 
-    return StreamCounter + getAndUpdateStreamPosition(0);
+    return data->counter + getAndUpdateStreamPosition(data, 0);
+}
+
+mm_word mmStreamGetPosition(void)
+{
+    return mmStreamGetPositionEx(0);
 }
 
 // Update stream with new data
-void mmStreamUpdate(void)
+void mmStreamUpdateEx(mm_word id)
 {
     // Catch inactive stream
-    if (!mmsData.is_active)
+    mm_stream_data *data = GetActiveStream(id);
+    if (data == NULL)
         return;
 
     // Determine how many samples to mix
-    StreamExecuteUpdate(getAndUpdateStreamPosition(1));
+    StreamExecuteUpdate(data, getAndUpdateStreamPosition(data, 1));
+}
+
+// Update all streams in manual mode with new data
+void mmStreamUpdate(void)
+{
+    for (mm_word id = 0; id < MM_STREAM_MAX; id++)
+    {
+        mm_stream_data *data = GetActiveStream(id);
+
+        if ((data != NULL) && !data->is_auto)
+            StreamExecuteUpdate(data, getAndUpdateStreamPosition(data, 1));
+    }
 }
 
 // Close audio stream
-void mmStreamClose(void)
+void mmStreamCloseEx(mm_word id)
 {
     // Catch inactive stream
-    if (!mmsData.is_active)
+    mm_stream_data *data = GetActiveStream(id);
+    if (data == NULL)
         return;
 
     // Disable hardware timer
-    mmsData.hw_timer[1] = TIMER_DISABLE;
+    data->hw_timer[1] = TIMER_DISABLE;
 
     // Disable irq
-    irqDisable(IRQ_TIMER(mmsData.hw_timer_num));
+    irqDisable(IRQ_TIMER(data->hw_timer_num));
+    mmsTimerStream[data->hw_timer_num] = NULL;
 
     // Disable system
-    mmsData.is_active = 0;
-    mmsData.is_auto = 0;
-    mmStreamEnd();
+    data->is_active = 0;
+    data->is_auto = 0;
+    mmStreamEnd(id);
 
 #ifdef ARM9
     // Free malloc'd memory
-    free(mmsData.work_memory);
-    free(mmsData.wave_memory);
+    free(data->work_memory);
+    free(data->wave_memory);
 #endif
 }
 
+void mmStreamClose(void)
+{
+    mmStreamCloseEx(0);
+}
+
 #ifdef ARM7
 
-static void init_sound_channel(mm_byte channel, mm_byte panning, uintptr_t wave_memory)
+static void init_sound_channel(mm_stream_data *data, mm_byte channel, mm_byte panning,
+                               uintptr_t wave_memory)
 {
     // Clear cnt, tmr and pnt
     REG_SOUNDXCNT(channel) = 0;
@@ -516,19 +885,19 @@ static void init_sound_channel(mm_byte channel, mm_byte panning, uintptr_t wave_
 
     // Copy src and tmr
     REG_SOUNDXSAD(channel) = wave_memory;
-    REG_SOUNDXTMR(channel) = -mmsData.clocks;
+    REG_SOUNDXTMR(channel) = -data->clocks;
 
     // Set length
-    REG_SOUNDXLEN(channel) = mmsData.length_words;
+    REG_SOUNDXLEN(channel) = data->length_words;
 
     // Set volume and panning
-    REG_SOUNDXVOL(channel) = streamVolume;
+    REG_SOUNDXVOL(channel) = mmsVolume[data->id];
     REG_SOUNDXPAN(channel) = panning;
 }
 
-static void start_sound_channel(mm_byte channel)
+static void start_sound_channel(mm_stream_data *data, mm_byte channel)
 {
-    REG_SOUNDXCNT(channel) |= (START_CHANNEL_LOOP | (get_cnt_format(mmsData.format) << 5)) << 24;
+    REG_SOUNDXCNT(channel) |= (START_CHANNEL_LOOP | (get_cnt_format(data->format) << 5)) << 24;
 }
 
 static void stop_sound_channel(mm_byte channel)
@@ -540,86 +909,98 @@ static void stop_sound_channel(mm_byte channel)
 }
 
 // Begin audio stream
-void mmStreamBegin(mm_addr wave_memory, mm_hword clks, mm_hword len, mm_stream_formats format)
+void mmStreamBegin(mm_word id, mm_addr wave_memory, mm_hword clks, mm_hword len,
+                   mm_stream_formats format)
 {
-    mmsData.is_active = 1;
-    mmsData.wave_memory = wave_memory;
-    mmsData.format = format;
-    mmsData.clocks = clks;
-    mmsData.length_cut = len;
-    mmsData.length_words = mmsData.length_cut >> (3 - get_shift_for_format(mmsData.format));
+    if (id >= MM_STREAM_MAX)
+        return;
+
+    mm_stream_data *data = &mmsStreams[id];
+
+    mm_byte channel_left = mmsChannels[id][0];
+    mm_byte channel_right = mmsChannels[id][1];
+
+    data->id = id;
+    data->is_active = 1;
+    data->wave_memory = wave_memory;
+    data->format = format;
+    data->clocks = clks;
+    data->length_cut = len;
+    data->length_words = data->length_cut >> (3 - get_shift_for_format(data->format));
 
-    // Lock channels 4 if stereo isn't set, 4 & 5 otherwise
+    // Lock the left channel if stereo isn't set, left & right otherwise
     // Then, set the channels up
-    if (is_stereo_format(mmsData.format))
+    if (is_stereo_format(data->format))
     {
-        mmLockChannels((1 << CHANNEL_LEFT) | (1 << CHANNEL_RIGHT));
-        init_sound_channel(CHANNEL_LEFT, LEFT_PANNING, (uintptr_t)mmsData.wave_memory);
-        init_sound_channel(CHANNEL_RIGHT, RIGHT_PANNING, ((uintptr_t)mmsData.wave_memory) + (mmsData.length_words << 2));
-        mmsData.length_words <<= 1;
+        mmLockChannels((1 << channel_left) | (1 << channel_right));
+        init_sound_channel(data, channel_left, LEFT_PANNING, (uintptr_t)data->wave_memory);
+        init_sound_channel(data, channel_right, RIGHT_PANNING, ((uintptr_t)data->wave_memory) + (data->length_words << 2));
+        data->length_words <<= 1;
     }
     else
     {
-        mmLockChannels(1 << CHANNEL_CENTER);
-        init_sound_channel(CHANNEL_CENTER, CENTER_PANNING, (uintptr_t)mmsData.wave_memory);
+        mmLockChannels(1 << channel_left);
+        init_sound_channel(data, channel_left, CENTER_PANNING, (uintptr_t)data->wave_memory);
     }
 
     mmSuspendIRQ_t();
 
     // Start channels
-    if (is_stereo_format(mmsData.format))
+    if (is_stereo_format(data->format))
     {
-        start_sound_channel(CHANNEL_LEFT);
-        start_sound_channel(CHANNEL_RIGHT);
+        start_sound_channel(data, channel_left);
+        start_sound_channel(data, channel_right);
     }
     else
     {
-        start_sound_channel(CHANNEL_CENTER);
+        start_sound_channel(data, channel_left);
     }
 
     mmRestoreIRQ_t();
 }
 
 // End audio stream
-void mmStreamEnd(void)
+void mmStreamEnd(mm_word id)
 {
+    if (id >= MM_STREAM_MAX)
+        return;
+
+    mm_stream_data *data = &mmsStreams[id];
+
     mmSuspendIRQ_t();
 
     // Stop channels
-    if (is_stereo_format(mmsData.format))
-    {
-        stop_sound_channel(CHANNEL_LEFT);
-        stop_sound_channel(CHANNEL_RIGHT);
-    }
-    else
-    {
-        stop_sound_channel(CHANNEL_CENTER);
-    }
+    stop_sound_channel(mmsChannels[id][0]);
+    if (is_stereo_format(data->format))
+        stop_sound_channel(mmsChannels[id][1]);
 
     mmRestoreIRQ_t();
 
-    mmsData.is_active = 0;
+    data->is_active = 0;
 }
 
-void mmStreamVolume(mm_byte volume)
+void mmStreamVolumeEx(mm_word id, mm_byte volume)
 {
+    if (id >= MM_STREAM_MAX)
+        return;
+
     // Clamp volume
-    streamVolume = volume > MAX_VOLUME ? MAX_VOLUME : volume;
+    mmsVolume[id] = volume > MAX_VOLUME ? MAX_VOLUME : volume;
 
     // Catch inactive stream
-    if (!mmsData.is_active)
+    mm_stream_data *data = &mmsStreams[id];
+    if (!data->is_active)
         return;
 
     // Set channel volumes
-    if (is_stereo_format(mmsData.format))
-    {
-        REG_SOUNDXVOL(CHANNEL_LEFT) = streamVolume;
-        REG_SOUNDXVOL(CHANNEL_RIGHT) = streamVolume;
-    }
-    else
-    {
-        REG_SOUNDXVOL(CHANNEL_CENTER) = streamVolume;
-    }
+    REG_SOUNDXVOL(mmsChannels[id][0]) = mmsVolume[id];
+    if (is_stereo_format(data->format))
+        REG_SOUNDXVOL(mmsChannels[id][1]) = mmsVolume[id];
+}
+
+void mmStreamVolume(mm_byte volume)
+{
+    mmStreamVolumeEx(0, volume);
 }
 
 #endif
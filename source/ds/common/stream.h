@@ -8,7 +8,11 @@
 
 #include <mm_types.h>
 
-void mmStreamBegin(mm_addr, mm_hword, mm_hword, mm_stream_formats);
-void mmStreamEnd(void);
+void mmStreamBegin(mm_word, mm_addr, mm_hword, mm_hword, mm_stream_formats);
+void mmStreamEnd(mm_word);
+
+// Assembly kernels in stream_asm.s
+void mmStreamDeinterleave8(const void *src, void *left, void *right, mm_word blocks);
+void mmStreamDeinterleave16(const void *src, void *left, void *right, mm_word blocks);
 
 #endif // MM_DS_COMMON_STREAM_H__
@@ -0,0 +1,134 @@
+// SPDX-License-Identifier: ISC
+//
+// Copyright (c) 2026, Antonio Niño Díaz (antonio_nd@outlook.com)
+
+// De-interleave kernels used to copy stereo stream data from the work buffer
+// to the left and right halves of the wave buffer. They only handle whole
+// blocks of samples with aligned pointers, the rest is done in C.
+
+    .syntax unified
+
+    .global mmStreamDeinterleave8
+    .type   mmStreamDeinterleave8 STT_FUNC
+    .global mmStreamDeinterleave16
+    .type   mmStreamDeinterleave16 STT_FUNC
+
+//----------------------------------------------------------------------
+    .text
+    .arm
+    .balign 4
+//----------------------------------------------------------------------
+
+//----------------------------------------------------------------------
+// void mmStreamDeinterleave8(const void *src, void *left, void *right,
+//                            mm_word blocks)
+//
+// Copies blocks of 8 stereo 8-bit samples (16 bytes of the source, 8 bytes of
+// each destination). All pointers must be aligned to 4 bytes.
+//----------------------------------------------------------------------
+
+    src     .req r0
+    left    .req r1
+    right   .req r2
+    blocks  .req r3
+    mask    .req r12
+
+mmStreamDeinterleave8:
+    cmp     blocks, #0
+    bxeq    lr
+
+    push    {r4-r11, lr}
+
+    ldr     mask, =0x00FF00FF
+
+1:  ldmia   src!, {r4-r7}                       // L0 R0 L1 R1 ... L7 R7
+
+    and     r8, r4, mask                        // left: L0 L1 L2 L3
+    orr     r8, r8, r8, lsr #8
+    and     lr, r5, mask
+    orr     lr, lr, lr, lsr #8
+    mov     r8, r8, lsl #16
+    mov     r8, r8, lsr #16
+    orr     r8, r8, lr, lsl #16
+
+    and     r9, mask, r4, lsr #8                // right: R0 R1 R2 R3
+    orr     r9, r9, r9, lsr #8
+    and     lr, mask, r5, lsr #8
+    orr     lr, lr, lr, lsr #8
+    mov     r9, r9, lsl #16
+    mov     r9, r9, lsr #16
+    orr     r9, r9, lr, lsl #16
+
+    and     r10, r6, mask                       // left: L4 L5 L6 L7
+    orr     r10, r10, r10, lsr #8
+    and     lr, r7, mask
+    orr     lr, lr, lr, lsr #8
+    mov     r10, r10, lsl #16
+    mov     r10, r10, lsr #16
+    orr     r10, r10, lr, lsl #16
+
+    and     r11, mask, r6, lsr #8               // right: R4 R5 R6 R7
+    orr     r11, r11, r11, lsr #8
+    and     lr, mask, r7, lsr #8
+    orr     lr, lr, lr, lsr #8
+    mov     r11, r11, lsl #16
+    mov     r11, r11, lsr #16
+    orr     r11, r11, lr, lsl #16
+
+    stmia   left!, {r8, r10}
+    stmia   right!, {r9, r11}
+
+    subs    blocks, blocks, #1
+    bne     1b
+
+    pop     {r4-r11, lr}
+    bx      lr
+
+//----------------------------------------------------------------------
+// void mmStreamDeinterleave16(const void *src, void *left, void *right,
+//                             mm_word blocks)
+//
+// Copies blocks of 4 stereo 16-bit samples (16 bytes of the source, 8 bytes of
+// each destination). All pointers must be aligned to 4 bytes.
+//----------------------------------------------------------------------
+
+mmStreamDeinterleave16:
+    cmp     blocks, #0
+    bxeq    lr
+
+    push    {r4-r11, lr}
+
+1:  ldmia   src!, {r4-r7}                       // Each word is L | (R << 16)
+
+    mov     r8, r4, lsl #16                     // left: L0 L1
+    mov     r8, r8, lsr #16
+    orr     r8, r8, r5, lsl #16
+
+    mov     r9, r5, lsr #16                     // right: R0 R1
+    mov     r9, r9, lsl #16
+    orr     r9, r9, r4, lsr #16
+
+    mov     r10, r6, lsl #16                    // left: L2 L3
+    mov     r10, r10, lsr #16
+    orr     r10, r10, r7, lsl #16
+
+    mov     r11, r7, lsr #16                    // right: R2 R3
+    mov     r11, r11, lsl #16
+    orr     r11, r11, r6, lsr #16
+
+    stmia   left!, {r8, r10}
+    stmia   right!, {r9, r11}
+
+    subs    blocks, blocks, #1
+    bne     1b
+
+    pop     {r4-r11, lr}
+    bx      lr
+
+    .unreq  src
+    .unreq  left
+    .unreq  right
+    .unreq  blocks
+    .unreq  mask
+
+    .pool
@@ -16,6 +16,7 @@
 #include "core/mixer.h"
 #include "core/player_types.h"
 #include "gba/mixer.h"
+#include "gba/sample_cache.h"
 
 #define DEFAULT_MIXLEN MM_MIXLEN_16KHZ
 
@@ -37,6 +38,9 @@ static mm_addr mm_init_default_buffer = NULL;
 // This is set to true when Maxmod is initialized
 static bool mm_initialized = false;
 
+// Samples mixed since the start of the current frame of audio
+static mm_word mm_frame_samples;
+
 // Initialize maxmod
 bool mmInit(mm_gba_system *setup)
 {
@@ -53,7 +57,12 @@ bool mmInit(mm_gba_system *setup)
     if ((mm_num_mch > 32) || (mm_num_ach > 32))
         return false;
 
-    mmMixerInit(setup); // Initialize software/hardware mixer
+    if (!mmMixerInit(setup)) // Initialize software/hardware mixer
+        return false;
+
+    mm_frame_samples = 0;
+
+    mmSampleCacheInit(setup->sample_cache, setup->sample_cache_size);
 
     mm_ch_mask = (1U << mm_num_ach) - 1;
 
@@ -130,24 +139,10 @@ bool mmEnd(void)
     return true;
 }
 
-// Work routine, user _must_ call this every frame.
-void mmFrame(void)
+// Update main layer and mix samples.
+// Main layer is sample-accurate.
+static void mmMixMainLayer(int remaining_len)
 {
-    if (!mm_initialized)
-        return;
-
-    // Update effects
-
-    mmUpdateEffects();
-
-    // Update sub layer
-    // Sub layer has 60hz accuracy
-
-    mppUpdateSub();
-
-    // Update main layer and mix samples.
-    // Main layer is sample-accurate.
-
     // Copy channels
     mpp_channels = mm_pchannels;
 
@@ -165,13 +160,11 @@ void mmFrame(void)
     if (mpp_layerp->isplaying == 0)
     {
         // Main layer isn't active, mix full amount
-        mmMixerMix(mm_mixlen);
+        mmMixerMix(remaining_len);
         return;
     }
 
-    // mixlen is divisible by 2
-    int remaining_len = mm_mixlen;
-
+    // remaining_len is divisible by 2
     while (1)
     {
         // Get samples/tick
@@ -209,6 +202,40 @@ void mmFrame(void)
     mmMixerMix(remaining_len);
 }
 
+// Work routine, user _must_ call this every frame.
+void mmFrame(void)
+{
+    if (!mm_initialized)
+        return;
+
+    mmSampleCacheUpdate();
+
+    mm_word chunks = mmMixerPendingChunks();
+
+    for (mm_word i = 0; i < chunks; i++)
+    {
+        if (mm_frame_samples == 0)
+        {
+            // Update effects
+
+            mmUpdateEffects();
+
+            // Update sub layer
+            // Sub layer has 60hz accuracy
+
+            mppUpdateSub();
+        }
+
+        mmMixMainLayer(mm_chunklen);
+
+        mmMixerNextChunk();
+
+        mm_frame_samples += mm_chunklen;
+        if (mm_frame_samples == mm_mixlen)
+            mm_frame_samples = 0;
+    }
+}
+
 mm_word mmGetModuleCount(void)
 {
     return mmModuleCount;
@@ -16,7 +16,7 @@
 #define ARM_CODE   __attribute__((target("arm")))
 #define IWRAM_CODE __attribute__((section(".iwram"), long_call))
 
-mm_byte mp_mix_seg; // Mixing segment select
+mm_byte mp_mix_seg; // Frame of the wave buffer being played
 
 mm_addr mm_mixbuffer;
 
@@ -30,8 +30,24 @@ mm_word mm_ratescale;
 
 mm_addr mp_writepos; // wavebuffer write position
 
+mm_word mm_wavelen; // Size of the wave buffer of one output channel (bytes)
+
+mm_word mm_chunklen; // Samples in a chunk of the wave buffer
+
 static mm_addr mm_wavebuffer;
 
+static mm_word mm_wave_frames; // Frames of audio in the wave buffer
+
+static mm_word mm_frame_chunks; // Chunks in a frame of audio
+
+static mm_word mm_chunk_count; // Chunks in the wave buffer
+
+static mm_word mm_mix_ahead; // Chunks mixed ahead of the chunk being played
+
+static mm_word mm_write_chunk; // Next chunk to be mixed
+
+static mm_word mm_line_samples; // Samples played per scanline (16.16)
+
 static mm_word mm_mixch_count;
 
 mm_mixer_channel *mm_mixch_end;
@@ -91,11 +107,13 @@ IWRAM_CODE ARM_CODE void mmVBlank(void)
     // Disable until ready
     if (vblank_handler_enabled)
     {
-        // Swap mixing segment
-        mp_mix_seg = ~mp_mix_seg;
+        // Advance to the next frame of the wave buffer
+        mp_mix_seg++;
 
-        if (mp_mix_seg != 0)
+        if (mp_mix_seg == mm_wave_frames)
         {
+            mp_mix_seg = 0;
+
             // DMA control: Restart DMA
 
             // Disable DMA
@@ -106,11 +124,6 @@ IWRAM_CODE ARM_CODE void mmVBlank(void)
             REG_DMA1CNT_H = 0xB600;
             REG_DMA2CNT_H = 0xB600;
         }
-        else
-        {
-            // Restart write position
-            mp_writepos = mm_wavebuffer;
-        }
     }
 
     // Call user handler
@@ -130,9 +143,111 @@ mm_voidfunc mmGetVBlankHandler(void)
     return mm_vblank_function;
 }
 
+// Returns the chunk of the wave buffer that is being played
+static mm_word mmMixerPlayChunk(void)
+{
+    mm_word chunk = mp_mix_seg * mm_frame_chunks;
+
+    if (mm_frame_chunks == 1)
+        return chunk;
+
+    // The DMA is restarted at the start of the VBlank period, so the playback
+    // position can be calculated from the number of scanlines since then. Add
+    // the size of the sound FIFO because the DMA reads samples before they are
+    // played.
+    mm_word line = REG_VCOUNT;
+    line = (line >= 160) ? line - 160 : line + 68;
+
+    mm_word pos = ((line * mm_line_samples) >> 16) + 32;
+
+    while (pos >= mm_chunklen)
+    {
+        pos -= mm_chunklen;
+        chunk++;
+    }
+
+    if (chunk >= mm_chunk_count)
+        chunk -= mm_chunk_count;
+
+    return chunk;
+}
+
+// Returns the number of chunks that need to be mixed to refill the wave buffer
+mm_word mmMixerPendingChunks(void)
+{
+    mm_word play = mmMixerPlayChunk();
+
+    // Chunks that are ready to be played after the one being played
+    mm_word ready = mm_write_chunk + mm_chunk_count - play - 1;
+    if (ready >= mm_chunk_count)
+        ready -= mm_chunk_count;
+
+    if (ready > mm_mix_ahead)
+    {
+        // mmFrame() hasn't been called in time and the chunks that were mixed
+        // have already been played. Start mixing again right after the chunk
+        // being played.
+        mm_write_chunk = play + 1;
+        if (mm_write_chunk == mm_chunk_count)
+            mm_write_chunk = 0;
+
+        mp_writepos = (mm_addr)((mm_word)mm_wavebuffer + mm_write_chunk * mm_chunklen);
+
+        ready = 0;
+    }
+
+    return mm_mix_ahead - ready;
+}
+
+// Move to the next chunk of the wave buffer after mixing a full chunk
+void mmMixerNextChunk(void)
+{
+    mm_write_chunk++;
+
+    if (mm_write_chunk == mm_chunk_count)
+    {
+        mm_write_chunk = 0;
+
+        // Restart write position
+        mp_writepos = mm_wavebuffer;
+    }
+}
+
 // Initialize mixer
-void mmMixerInit(mm_gba_system *setup)
+bool mmMixerInit(mm_gba_system *setup)
 {
+    mm_word frames = setup->wave_frames;
+    if (frames == 0)
+        frames = 2;
+
+    if ((frames < 2) || (frames > MM_WAVE_FRAMES_MAX))
+        return false;
+
+    mm_word chunks = setup->frame_chunks;
+    if (chunks == 0)
+        chunks = 1;
+
+    // All mixing lengths are divisible by 8, so chunks always have an even
+    // number of samples.
+    if ((chunks != 1) && (chunks != 2) && (chunks != 4))
+        return false;
+
+    mm_word ahead = setup->mix_ahead;
+    if (ahead == 0)
+        ahead = chunks * (frames - 1);
+
+    // When the playback position is calculated from the current scanline it
+    // may be one chunk ahead of the real position.
+    mm_word max_ahead = chunks * frames - ((chunks == 1) ? 1 : 2);
+    if (ahead > max_ahead)
+        return false;
+
+    mm_wave_frames = frames;
+    mm_frame_chunks = chunks;
+    mm_chunk_count = chunks * frames;
+    mm_mix_ahead = ahead;
+    mm_write_chunk = 0;
+
     mm_mixch_count = setup->mix_channel_count;
 
     mm_mix_channels = setup->mixing_channels;
@@ -155,6 +270,13 @@ void mmMixerInit(mm_gba_system *setup)
 
     mm_mixlen = mp_mixing_lengths[mode];
 
+    mm_chunklen = mm_mixlen / mm_frame_chunks;
+
+    mm_wavelen = mm_mixlen * mm_wave_frames;
+
+    // There are 228 scanlines per frame
+    mm_line_samples = (mm_mixlen << 16) / 228;
+
     // 15768*16384 / rate
     static const mm_hword mp_rate_scales[] = {
         31812, 24576, 19310, 16384, 14228, 12288,  9655,  8192
@@ -180,10 +302,10 @@ void mmMixerInit(mm_gba_system *setup)
     mm_bpmdv = mp_bpm_divisors[mode];
 
     // Clear wave buffer
-    memset(mm_wavebuffer, 0, mm_mixlen * sizeof(mm_word));
+    memset(mm_wavebuffer, 0, mm_wavelen * 2);
 
-    // Reset mixing segment
-    mp_mix_seg = 0;
+    // Reset mixing segment. The first VBlank interrupt will restart the DMA.
+    mp_mix_seg = mm_wave_frames - 1;
 
     // Disable mixing channels
 
@@ -207,7 +329,7 @@ void mmMixerInit(mm_gba_system *setup)
 
     // Setup DMA source addresses (playback buffers)
     REG_DMA1SAD = (mm_word)mm_wavebuffer;
-    REG_DMA2SAD = (mm_word)mm_wavebuffer + mm_mixlen * 2;
+    REG_DMA2SAD = (mm_word)mm_wavebuffer + mm_wavelen;
 
     // Setup DMA destination (sound fifo)
     REG_DMA1DAD = (mm_word)REG_SGFIFOA;
@@ -222,6 +344,8 @@ void mmMixerInit(mm_gba_system *setup)
 
     // Enable sampling timer
     REG_TM0CNT = mm_timerfreq | (0x80 << 16);
+
+    return true;
 }
 
 void mmMixerEnd(void)
@@ -12,6 +12,8 @@
 #define REG_SOUNDCNT_H  *(volatile uint16_t *)0x4000082
 #define REG_SOUNDCNT_X  *(volatile uint16_t *)0x4000084
 
+#define REG_VCOUNT      *(volatile uint16_t *)0x4000006
+
 #define REG_TM0CNT      *(volatile uint32_t *)0x4000100
 
 #define REG_DMA1SAD     *(volatile uint32_t *)0x40000BC
@@ -32,12 +34,16 @@
 #define REG_SGFIFOB     (volatile uint32_t *)0x40000A4
 
 extern mm_mixer_channel *mm_mix_channels;
+extern mm_mixer_channel *mm_mixch_end;
 extern mm_word mm_mixlen;
+extern mm_word mm_chunklen;
 
 extern mm_word mm_bpmdv;
 
-void mmMixerInit(mm_gba_system* setup);
+bool mmMixerInit(mm_gba_system* setup);
 void mmMixerMix(mm_word samples_count);
+mm_word mmMixerPendingChunks(void);
+void mmMixerNextChunk(void);
 void mmMixerSetRead(int channel, mm_word value);
 void mmMixerEnd(void);
 
@@ -35,7 +35,7 @@
     .equ    CHN_READ, 4
     .equ    CHN_VOL,  8
     .equ    CHN_PAN,  9
-    // 10
+    .equ    CHN_BUS,  10
     // 11
     .equ    CHN_FREQ, 12
 
@@ -44,8 +44,12 @@
 //-------------------------------------
 
     .equ    FETCH_SIZE, 384
-    // Frequency threshold (dont use fetch for high freqs!)
-    .equ    FETCH_THRESHOLD, (6016) // 7040
+
+    // Loops shorter than this (in samples) are never fetched, the overhead of
+    // restarting the fetch at every loop point is higher than the savings.
+    .equ    FETCH_MIN_LOOP, 64
+
+    .equ    REG_WAITCNT, 0x4000204
 
 //======================================================================
 //                               MEMORY
@@ -56,6 +60,13 @@
 
 mm_fetch:           .space FETCH_SIZE + 16
 
+// Frequency threshold for samples in ROM with the current waitstates
+mpm_rom_threshold:  .space 4
+
+// Frequency threshold of the channel being mixed (dont use fetch for high
+// freqs!). It is zero if the channel never uses fetch.
+mpm_fetch_limit:    .space 4
+
 // 11-bit mixed sample buffer
 // data is interleaved
 // left, left, right, right, left, left, etc...
@@ -76,6 +87,15 @@ mpm_nullsample:
     .byte   128
 
 
+    .balign 4
+// Frequency thresholds for fetching samples from ROM. Fetching is worth it when
+// the cycles saved by reading samples from IWRAM instead of ROM are more than
+// the cycles needed to copy them. The table is indexed by the WS0 bits of
+// REG_WAITCNT (first access, second access). 6016 is the value for 3,1.
+mpm_fetch_thresholds:
+    .word   5762,  4321,  2881,  11523  // 4,2 - 3,2 - 2,2 - 8,2
+    .word   8021,  6016,  4011,  16043  // 4,1 - 3,1 - 2,1 - 8,1
+
     .balign 4
 //-------------------------------------------------------------------------
 mmMixerMix: // params = { samples_count }
@@ -131,6 +151,16 @@ mmMixerMix: // params = { samples_count }
     bne     1b
 2:
 
+// get fetch threshold for the current ROM waitstates
+
+    ldr     r0, =REG_WAITCNT
+    ldrh    r0, [r0]
+    and     r0, r0, #0x1C               // WS0 bits, already multiplied by 4
+    ldr     r1, =mpm_fetch_thresholds
+    ldr     r0, [r1, r0]
+    ldr     r1, =mpm_rom_threshold
+    str     r0, [r1]
+
 //----------------------------------------------------------------------------------
 // BEGIN MIXING ROUTINE
 //----------------------------------------------------------------------------------
@@ -176,6 +206,18 @@ mmMixerMix: // params = { samples_count }
     mul     rfreq, r0
     lsr     rfreq, #14
 
+// select fetch strategy
+
+    ldr     r0, =mpm_rom_threshold
+    ldr     r0, [r0]
+    cmp     rsrc, #0x08000000                   // samples in EWRAM/IWRAM are
+    movlo   r0, #0                              // read directly
+    ldr     r1, [rsrc, #-C_SAMPLE_DATA + C_SAMPLE_LOOP]
+    cmp     r1, #FETCH_MIN_LOOP                 // short loops are read directly
+    movlo   r0, #0                              // (no loop is 0xFFFFFFFF)
+    ldr     r1, =mpm_fetch_limit
+    str     r0, [r1]
+
 // load mixing buffers
 
     ldr     rmixb, =mm_mixbuffer
@@ -188,6 +230,11 @@ mmMixerMix: // params = { samples_count }
 // calculate volume
 
     ldrb    rvolR, [rchan, #CHN_VOL]    // volume = 0-255
+    ldrb    r1, [rchan, #CHN_BUS]       // scale by gain of the bus
+    ldr     r2, =mm_bus_gain            // gain = 0-256
+    ldr     r1, [r2, r1, lsl #2]
+    mul     rvolR, r1, rvolR
+    mov     rvolR, rvolR, lsr #8
     ldrb    r0, [rchan, #CHN_PAN]       // pan = 0-255
 
     rsb     r0, r0, #256
@@ -208,7 +255,9 @@ mmMixerMix: // params = { samples_count }
     mov     r2, #0
     mul     r1, rmixc, rfreq            // get number of samples that will be read
 
-    cmp     rfreq, #FETCH_THRESHOLD
+    ldr     r0, =mpm_fetch_limit
+    ldr     r0, [r0]
+    cmp     rfreq, r0
     bge     1f
 
     cmp     r1, #FETCH_SIZE << MP_SAMPFRAC // check if its > fetch size
@@ -291,7 +340,9 @@ mmMixerMix: // params = { samples_count }
     cmp     rmixcc, #0
     beq     .mpm_mix_complete           // exit -------->
 
-    cmp     rfreq, #FETCH_THRESHOLD
+    ldr     r0, =mpm_fetch_limit
+    ldr     r0, [r0]
+    cmp     rfreq, r0
     bge     .dont_use_fetch
 
     // [cycle timings assume 3,1 ROM waitstates]
@@ -407,7 +458,9 @@ fooo:
     b       mmMix_Skip                          // skip samples if zero
 .mpm_mix_complete:
 
-    cmp     rfreq, #FETCH_THRESHOLD
+    ldr     r1, =mpm_fetch_limit
+    ldr     r1, [r1]
+    cmp     rfreq, r1
     poplt   {r0, rsrc}                          // restore regs
     addlt   rread, rread, r0, lsl #MP_SAMPFRAC  // add old integer to read
     ldmfd   sp!, {rmixc,rvolA,rchan}            // restore more regs
@@ -489,9 +542,9 @@ fooo:
 
     ldr     prwritel, =mp_writepos
     ldr     prwritel, [prwritel]
-    ldr     prwriter, =mm_mixlen
+    ldr     prwriter, =mm_wavelen
     ldr     prwriter, [prwriter]
-    add     prwriter, prwritel, prwriter, lsl #1 // #MP_MIXLEN * 2
+    add     prwriter, prwritel, prwriter        // right output follows left output
     ldmfd   sp!, {prcount}
 
 // get volume accumulators
@@ -0,0 +1,309 @@
+// SPDX-License-Identifier: ISC
+//
+// Copyright (c) 2026, Antonio Niño Díaz (antonio_nd@outlook.com)
+
+// Cache of copies of frequently triggered samples in RAM.
+//
+// Mixing samples stored in ROM is slow because of the ROM waitstates. Most
+// triggers in a game are usually short samples that are played over and over
+// (percussion, UI sounds...), so keeping a copy of them in RAM reduces the cost
+// of mixing them a lot.
+//
+// Every time a note or a sound effect is started the sample is looked up in a
+// small table of candidates that counts how many times it has been triggered.
+// The counters are halved periodically so that the cache follows the samples
+// that are being used at the moment. Samples are copied to the cache by
+// mmFrame(), not when they are triggered, so starting a sound is always fast.
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <maxmod.h>
+#include <mm_mas.h>
+
+#include "core/channel_types.h"
+#include "gba/mixer.h"
+#include "gba/sample_cache.h"
+
+// Number of samples whose triggers are counted
+#define CACHE_CANDIDATES    16
+
+// Number of triggers needed before a sample is copied to the cache
+#define CACHE_MIN_TRIGGERS  4
+
+// Number of triggers between halvings of all the trigger counters
+#define CACHE_AGE_PERIOD    256
+
+// Loops shorter than this (in samples) are unrolled in the copy until they are
+// at least this long, so that the mixer has to handle the end of the loop less
+// often.
+#define CACHE_LOOP_UNROLL_MIN   256
+
+typedef struct {
+    mm_mas_gba_sample *sample;  // Original sample, NULL if the slot is free
+    mm_mas_gba_sample *copy;    // Copy of the sample in the cache, or NULL
+    mm_word size;               // Size of the copy in bytes
+    mm_word count;              // Number of recent triggers
+} mm_cache_slot;
+
+static mm_cache_slot mm_cache_slots[CACHE_CANDIDATES];
+
+static mm_byte *mm_cache_memory;
+static mm_word mm_cache_size;
+static mm_word mm_cache_used;
+
+static mm_word mm_cache_triggers;
+
+void mmSampleCacheInit(mm_addr memory, mm_word size)
+{
+    mm_cache_memory = memory;
+    mm_cache_size = (memory == NULL) ? 0 : size;
+    mm_cache_used = 0;
+    mm_cache_triggers = 0;
+
+    memset(mm_cache_slots, 0, sizeof(mm_cache_slots));
+}
+
+// Returns the address that the mixer has to use to play the sample, and counts
+// one trigger of the sample.
+uintptr_t mmSampleCacheGet(mm_mas_gba_sample *sample)
+{
+    if (mm_cache_size == 0)
+        return (uintptr_t)&(sample->data[0]);
+
+    // Samples that aren't in ROM are already fast to read
+    if ((uintptr_t)sample < 0x08000000)
+        return (uintptr_t)&(sample->data[0]);
+
+    mm_cache_triggers++;
+    if (mm_cache_triggers == CACHE_AGE_PERIOD)
+    {
+        mm_cache_triggers = 0;
+
+        for (mm_word i = 0; i < CACHE_CANDIDATES; i++)
+            mm_cache_slots[i].count >>= 1;
+    }
+
+    mm_cache_slot *victim = NULL;
+
+    for (mm_word i = 0; i < CACHE_CANDIDATES; i++)
+    {
+        mm_cache_slot *slot = &mm_cache_slots[i];
+
+        if (slot->sample == sample)
+        {
+            slot->count++;
+
+            if (slot->copy != NULL)
+                return (uintptr_t)&(slot->copy->data[0]);
+
+            return (uintptr_t)&(sample->data[0]);
+        }
+
+        // Samples in the cache are never replaced from here, only by
+        // mmSampleCacheUpdate().
+        if (slot->copy != NULL)
+            continue;
+
+        if ((victim == NULL) || (slot->count < victim->count))
+            victim = slot;
+    }
+
+    // The sample isn't a candidate yet. Replace the candidate with the fewest
+    // triggers. It inherits its counter so that a new sample can eventually
+    // replace a candidate that has been triggered a lot in the past.
+    if (victim != NULL)
+    {
+        victim->sample = sample;
+        victim->count++;
+    }
+
+    return (uintptr_t)&(sample->data[0]);
+}
+
+// Returns the number of samples added to the end of a sample when its loop is
+// unrolled in the cache.
+static mm_word mmSampleCacheUnrollSize(mm_mas_gba_sample *sample)
+{
+    mm_word loop_length = sample->loop_length;
+
+    // This also skips samples without loop (0xFFFFFFFF)
+    if ((loop_length == 0) || (loop_length >= CACHE_LOOP_UNROLL_MIN))
+        return 0;
+
+    mm_word copies = (CACHE_LOOP_UNROLL_MIN + loop_length - 1) / loop_length;
+
+    return (copies - 1) * loop_length;
+}
+
+// Make all channels that play a copy of a sample play from a different address.
+// The header of "dest" must already be valid when this is called.
+static void mmSampleCacheMove(mm_cache_slot *slot, mm_mas_gba_sample *dest)
+{
+    uintptr_t old_src = (uintptr_t)&(slot->copy->data[0]);
+    uintptr_t new_src = (uintptr_t)&(dest->data[0]);
+
+    // When going back to the original sample the read position may be inside
+    // the unrolled part of the loop, which doesn't exist in the original.
+    mm_word length = dest->length << MP_SAMPFRAC;
+    mm_word loop_length = dest->loop_length << MP_SAMPFRAC;
+
+    for (mm_mixer_channel *mix_ch = mm_mix_channels; mix_ch != mm_mixch_end; mix_ch++)
+    {
+        if (mix_ch->src != old_src)
+            continue;
+
+        mix_ch->src = new_src;
+
+        // Samples without loop can't be read past their end
+        if ((dest->loop_length == 0xFFFFFFFF) || (dest->loop_length == 0))
+            continue;
+
+        while (mix_ch->read >= length)
+            mix_ch->read -= loop_length;
+    }
+}
+
+// Remove a sample from the cache and pack all the other copies together
+static void mmSampleCacheEvict(mm_cache_slot *evicted)
+{
+    mmSampleCacheMove(evicted, evicted->sample);
+
+    mm_byte *start = (mm_byte *)evicted->copy;
+    mm_word size = evicted->size;
+
+    evicted->copy = NULL;
+    evicted->size = 0;
+
+    // Copies need to be moved in order of address so that they don't overwrite
+    // copies that haven't been moved yet.
+    while (1)
+    {
+        mm_cache_slot *next = NULL;
+
+        for (mm_word i = 0; i < CACHE_CANDIDATES; i++)
+        {
+            mm_cache_slot *slot = &mm_cache_slots[i];
+
+            if ((mm_byte *)slot->copy <= start)
+                continue;
+
+            if ((next == NULL) || (slot->copy < next->copy))
+                next = slot;
+        }
+
+        if (next == NULL)
+            break;
+
+        mm_mas_gba_sample *dest = (mm_mas_gba_sample *)start;
+
+        // Move the data before the channels so that they see the header of the
+        // moved copy, not the header of the evicted one.
+        memmove(dest, next->copy, next->size);
+        mmSampleCacheMove(next, dest);
+        next->copy = dest;
+
+        start += next->size;
+    }
+
+    mm_cache_used -= size;
+}
+
+// Copy the most triggered sample that isn't cached yet, evicting samples that
+// have been triggered fewer times if there isn't enough space. This is called
+// by mmFrame() before mixing.
+void mmSampleCacheUpdate(void)
+{
+    if (mm_cache_size == 0)
+        return;
+
+    mm_cache_slot *best = NULL;
+
+    for (mm_word i = 0; i < CACHE_CANDIDATES; i++)
+    {
+        mm_cache_slot *slot = &mm_cache_slots[i];
+
+        if ((slot->sample == NULL) || (slot->copy != NULL))
+            continue;
+
+        if (slot->count < CACHE_MIN_TRIGGERS)
+            continue;
+
+        if ((best == NULL) || (slot->count > best->count))
+            best = slot;
+    }
+
+    if (best == NULL)
+        return;
+
+    mm_word length = best->sample->length;
+    mm_word unroll = mmSampleCacheUnrollSize(best->sample);
+
+    mm_word size = sizeof(mm_mas_gba_sample) + length + unroll;
+    size = (size + 3) & ~3;
+
+    if (size > mm_cache_size)
+    {
+        // This sample will never fit, stop counting it
+        best->count = 0;
+        return;
+    }
+
+    // Check if there is enough space after removing all the copies of samples
+    // that have been triggered less often.
+    mm_word available = mm_cache_size - mm_cache_used;
+
+    for (mm_word i = 0; i < CACHE_CANDIDATES; i++)
+    {
+        mm_cache_slot *slot = &mm_cache_slots[i];
+
+        if ((slot->copy != NULL) && (slot->count < best->count))
+            available += slot->size;
+    }
+
+    if (available < size)
+        return;
+
+    while (mm_cache_size - mm_cache_used < size)
+    {
+        mm_cache_slot *victim = NULL;
+
+        for (mm_word i = 0; i < CACHE_CANDIDATES; i++)
+        {
+            mm_cache_slot *slot = &mm_cache_slots[i];
+
+            if (slot->copy == NULL)
+                continue;
+
+            if ((victim == NULL) || (slot->count < victim->count))
+                victim = slot;
+        }
+
+        mmSampleCacheEvict(victim);
+    }
+
+    mm_mas_gba_sample *copy = (mm_mas_gba_sample *)(mm_cache_memory + mm_cache_used);
+
+    memcpy(copy, best->sample, sizeof(mm_mas_gba_sample) + length);
+
+    if (unroll > 0)
+    {
+        // Append copies of the loop after the end of the sample and extend the
+        // loop to include them. The mixer sees one long loop, and the read
+        // positions that are valid in the original sample are still valid.
+        mm_word loop_length = copy->loop_length;
+        mm_byte *loop = &(copy->data[length - loop_length]);
+
+        for (mm_word i = 0; i < unroll; i++)
+            copy->data[length + i] = loop[i];
+
+        copy->length = length + unroll;
+        copy->loop_length = loop_length + unroll;
+    }
+
+    best->copy = copy;
+    best->size = size;
+
+    mm_cache_used += size;
+}
@@ -0,0 +1,17 @@
+// SPDX-License-Identifier: ISC
+//
+// Copyright (c) 2026, Antonio Niño Díaz (antonio_nd@outlook.com)
+
+#ifndef MM_GBA_SAMPLE_CACHE_H
+#define MM_GBA_SAMPLE_CACHE_H
+
+#include <stdint.h>
+
+#include <mm_mas.h>
+#include <mm_types.h>
+
+void mmSampleCacheInit(mm_addr memory, mm_word size);
+uintptr_t mmSampleCacheGet(mm_mas_gba_sample *sample);
+void mmSampleCacheUpdate(void);
+
+#endif // MM_GBA_SAMPLE_CACHE_H